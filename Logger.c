@@ -1,7 +1,42 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // fallocate() for standby log file
+#endif
+#include <stdatomic.h>
+#include <stddef.h>
 #include "Logger.h"
 
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
 #define DEFAULT_FILE_SIZE 1048576L // 1 MB
-#define FILE_TIMESTAMP_LENGTH (sizeof("_yyyy-MM-dd") + 5)    // For example: _2023-05-03 + additional designators for files with same name
+#define FILE_TIMESTAMP_LENGTH (sizeof("_yyyy-MM-dd_HH") + 5)    // For example: _2023-05-03 or _2023-05-03_14 + additional designators for files with same name
+#define TIMESTAMP_MAX_LENGTH 32
+#define NO_SUBSCRIBERS_LEVEL (LOG_LEVEL_FATAL + 1)
+#define LOG_LEVEL_COUNT (LOG_LEVEL_FATAL + 1)
+#define CONVERSION_MAX_LENGTH 32    // single format specification, for example: "%-08.3lld"
+#define NULL_STRING_LENGTH UINT16_MAX
+#define SNAPSHOT_WAIT_SLEEP_US 50
+#define SNAPSHOT_READER_SLOTS 64    // threads are spread over slots, so dispatching threads rarely share a counter
+#define BINARY_FILE_VERSION 1
+#define BINARY_TYPE_SIZE_COUNT 9
+#define BINARY_TEMPORARY_TAG_ID UINT16_MAX  // tag that does not fit into dictionary, replaced by each next one
+#define DEDUPLICATION_TAG_SIZE 64
+#define BACKUP_NAME_MAX_ID 9999    // fits into additional designators of FILE_TIMESTAMP_LENGTH
+#define ROTATED_NAME_SUFFIX_LENGTH 24   // ".<rotation id>.rotated" with null character
+#define ROTATION_IDLE_SLEEP_US 10000
+#define STANDBY_NAME_SUFFIX ".standby"
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
 
 static const char *LEVEL_STRINGS[] = {
         [LOG_LEVEL_UNKNOWN] = "UNKNOWN",
@@ -13,15 +48,241 @@ static const char *LEVEL_STRINGS[] = {
         [LOG_LEVEL_FATAL] = "FATAL"};
 
 #ifdef USE_LOGGER_COLOR
-static const char *LEVEL_COLORS[] = {"\x1b[94m", "\x1b[36m", "\x1b[32m", "\x1b[33m", "\x1b[31m", "\x1b[35m"};
+static const char *LEVEL_COLORS[] = {
+        [LOG_LEVEL_UNKNOWN] = "\x1b[0m",
+        [LOG_LEVEL_TRACE] = "\x1b[94m",
+        [LOG_LEVEL_DEBUG] = "\x1b[36m",
+        [LOG_LEVEL_INFO] = "\x1b[32m",
+        [LOG_LEVEL_WARN] = "\x1b[33m",
+        [LOG_LEVEL_ERROR] = "\x1b[31m",
+        [LOG_LEVEL_FATAL] = "\x1b[35m"};
+static THREAD_LOCAL char coloredLineBuffer[LOGGER_BUFFER_SIZE];
+static atomic_bool hasConsoleSubscriber;
 static size_t formatColoredTagLevel(char *buffer, const char *tag, LogLevel severity, size_t timestampLength);
+static void renderColoredRecord(LogRecord *record);
 #endif
 
-static LoggerEvent loggerSubscriberArray[LOGGER_MAX_SUBSCRIBERS] = {0};
+struct LogRecord {  // message rendered once per logMessage() call and shared by all subscribers
+    const char *tag;
+    LogLevel severity;
+    struct timespec timestamp;
+    char *line;             // "timestamp | LEVEL | TAG - message\n"
+    size_t length;
+    size_t timestampLength;
+    size_t messageOffset;   // start of formatted message in line
+    const LogFormat *format;    // not NULL when message arguments are captured for binary logging
+    const uint8_t *arguments;
+    uint16_t argumentsLength;
+    uint32_t tagHash;       // computed on first check of subscriber tag filters
+    bool isTagHashed;
+    uint64_t messageHash;   // hash of tag, level and message, computed on first check of subscriber deduplicator
+    bool isMessageHashed;
+#ifdef USE_LOGGER_COLOR
+    char *coloredLine;      // same line with colored level, rendered on first use
+    size_t coloredLength;
+#endif
+};
+
+static LoggerEvent **subscriberRegistry = NULL;    // dense list of heap allocated subscribers, removal moves the last one into the gap
+static uint32_t subscriberCount = 0;
+static uint32_t subscriberCapacity = 0;
+static LoggerEvent *retiredSubscribers = NULL;     // records of unsubscribed loggers, never reused
+
+typedef struct LoggerSnapshot {     // immutable list of active subscribers, replaced as a whole on every change
+    uint32_t count;
+    uint32_t levelOffsets[LOG_LEVEL_COUNT + 1];    // subscribers accepting level are in [levelOffsets[level], levelOffsets[level + 1])
+    LoggerEvent *subscribers[];     // all subscribers, followed by subscriber list of each level
+} LoggerSnapshot;
+
+static LoggerSnapshot emptySnapshot = {0};
+static LoggerSnapshot *snapshotBuffers[2];  // sized to registry capacity, writers wait for readers of previous snapshot, so two are enough
+static _Atomic(LoggerSnapshot *) currentSnapshot = &emptySnapshot;
+typedef struct SnapshotReaderSlot {     // counters on own cache line, so readers of other slots don't invalidate them
+    _Alignas(64) atomic_uint readers[2];    // readers that entered in even and odd epoch
+} SnapshotReaderSlot;
+
+static atomic_uint snapshotEpoch;
+static SnapshotReaderSlot snapshotReaderSlots[SNAPSHOT_READER_SLOTS];
+static atomic_uint lastReaderSlot;
 static char messageBuffer[LOGGER_BUFFER_SIZE] = {0};
+static THREAD_LOCAL char lineBuffer[LOGGER_BUFFER_SIZE];   // messages are rendered by each thread before taking the lock
+static THREAD_LOCAL SnapshotReaderSlot *readerSlot = NULL;  // assigned on the first dispatch of thread
+static THREAD_LOCAL uint8_t argumentBuffer[LOGGER_BUFFER_SIZE];  // captured arguments for binary file logger
+static atomic_bool hasBinarySubscriber;
+static atomic_bool hasTextSubscriber;
+static atomic_bool hasTagFilter;
+static THREAD_LOCAL char summaryLineBuffer[LOGGER_BUFFER_SIZE];   // repeated message summary, rendered while other record is dispatched
+static THREAD_LOCAL uint64_t randomState;  // xorshift state for sampled messages, seeded on first use by each thread
 
 static LoggerEvent ERROR_EVENT = {.buffer = messageBuffer};
 
+atomic_int loggerThresholdLevel = NO_SUBSCRIBERS_LEVEL;
+
+static LogTagEntry tagTable[LOGGER_MAX_TAGS];   // insert-only open addressing table, inserts are done with configuration lock
+static atomic_schar defaultTagLevel = LOG_LEVEL_UNKNOWN;
+
+typedef struct LogTagRule {     // node of dotted tag hierarchy, rule "net.http" is child "http" of node "net"
+    char *segment;
+    size_t length;
+    int8_t level;               // -1 if there is no rule for this node
+    struct LogTagRule *children;
+    struct LogTagRule *next;
+} LogTagRule;
+
+static LogTagRule tagRuleRoot = {.level = -1};  // changed and resolved only with configuration lock
+
+static const char *MONTH_NAMES[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+static const char DIGIT_PAIRS[] =
+        "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+        "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+static const uint8_t FRACTION_DIGITS[] = {
+        [LOG_TIMESTAMP_SECONDS] = 0,
+        [LOG_TIMESTAMP_MILLISECONDS] = 3,
+        [LOG_TIMESTAMP_MICROSECONDS] = 6,
+        [LOG_TIMESTAMP_NANOSECONDS] = 9};
+static const uint32_t FRACTION_DIVIDERS[] = {
+        [LOG_TIMESTAMP_SECONDS] = 1000000000,
+        [LOG_TIMESTAMP_MILLISECONDS] = 1000000,
+        [LOG_TIMESTAMP_MICROSECONDS] = 1000,
+        [LOG_TIMESTAMP_NANOSECONDS] = 1};
+static atomic_int timestampPrecision = LOGGER_TIMESTAMP_PRECISION;
+
+typedef struct TimestampCache {     // date and time rendered once per second for each thread
+    time_t second;
+    size_t length;
+    char text[TIMESTAMP_MAX_LENGTH];
+} TimestampCache;
+
+static THREAD_LOCAL TimestampCache timestampCache = {.second = -1};
+
+typedef enum LogArgumentType {
+    LOG_ARGUMENT_PERCENT,   // "%%", no argument
+    LOG_ARGUMENT_INT,
+    LOG_ARGUMENT_LONG,
+    LOG_ARGUMENT_LONG_LONG,
+    LOG_ARGUMENT_SIZE,
+    LOG_ARGUMENT_INTMAX,
+    LOG_ARGUMENT_PTRDIFF,
+    LOG_ARGUMENT_DOUBLE,
+    LOG_ARGUMENT_LONG_DOUBLE,
+    LOG_ARGUMENT_POINTER,
+    LOG_ARGUMENT_STRING,
+} LogArgumentType;
+
+typedef struct LogConversion {
+    uint16_t offset;        // start of specification in format string
+    uint8_t length;
+    uint8_t type;
+    uint8_t starCount;      // number of '*' width and precision arguments before value
+    bool hasStarPrecision;
+    int16_t precision;      // string precision, -1 if not specified
+} LogConversion;
+
+struct LogFormat {  // format string parsed once per call site for deferred formatting
+    const char *format;
+    uint16_t id;        // binary log dictionary id, 0 if ids are exhausted
+    bool isDeferrable;
+    uint8_t conversionCount;
+    LogConversion conversions[LOGGER_MAX_DEFERRED_ARGUMENTS];
+};
+
+typedef struct AsyncMessage {
+    atomic_size_t sequence;
+    LogLevel severity;
+    struct timespec timestamp;
+    const LogFormat *format;    // not NULL when text contains captured arguments instead of formatted message
+    uint16_t tagLength;
+    uint16_t argumentsLength;
+    char text[LOGGER_BUFFER_SIZE];  // null terminated tag followed by formatted message or captured arguments
+} AsyncMessage;
+
+typedef enum LogBinaryEntryType {
+    LOG_BINARY_RECORD = 1,  // record header followed by captured arguments or plain message text
+    LOG_BINARY_FORMAT,      // format string dictionary entry: id, length, text
+    LOG_BINARY_TAG,         // tag dictionary entry: id, length, text
+    LOG_BINARY_TIME,        // new base time for record timestamp deltas
+    LOG_BINARY_HEADER = 'L',    // "LOGB" file header, starts each file and appended session
+} LogBinaryEntryType;
+
+typedef struct LogBinaryRecordHeader {  // fixed width part of each record, written field by field without padding
+    uint8_t type;
+    uint8_t severity;
+    uint16_t tagId;
+    uint16_t formatId;      // 0 for plain text message
+    uint16_t length;
+    uint32_t timestampDelta;    // nanoseconds since previous record
+} LogBinaryRecordHeader;
+
+typedef struct LogBinaryTag {
+    char *name;
+    uint16_t id;
+} LogBinaryTag;
+
+struct LogBinaryDictionary {
+    bool isHeaderWritten;
+    struct timespec lastTimestamp;
+    uint8_t *writtenFormats;    // bitmap by format id
+    uint32_t writtenFormatsSize;
+    uint16_t tagCount;
+    LogBinaryTag tags[LOGGER_BINARY_MAX_TAGS];  // open addressing by tag hash
+};
+
+typedef struct LogTagFilterEntry {
+    uint32_t hash;
+    const char *name;
+} LogTagFilterEntry;
+
+struct LogTagFilter {   // immutable tag set of single subscriber, replaced as a whole
+    uint64_t mask;      // two bits of each tag hash, most tags outside of set are rejected without string compare
+    uint32_t count;
+    LogTagFilterEntry entries[];    // followed by tag names in the same allocation
+};
+
+struct LogDeduplicator {    // changed only with subscriber lock
+    uint32_t windowMs;
+    bool hasLastMessage;
+    uint64_t lastHash;
+    uint64_t streakStartTime;   // suppressed repeats are summarized when this window elapsed
+    uint32_t repeatCount;
+    LogLevel severity;
+    char tag[DEDUPLICATION_TAG_SIZE];
+};
+
+typedef struct LogRotationJob {     // rotated file handed over to rotation thread
+    LoggerEvent *subscriber;
+    FILE *out;              // closed by rotation thread, NULL if it's already closed
+    char *writeBuffer;      // write buffer of rotated file, returned to subscriber after close
+    uint64_t size;
+    time_t timestamp;       // backup name timestamp
+    struct LogRotationJob *next;
+    char name[];            // temporary name of rotated file, empty if file was not renamed
+} LogRotationJob;
+
+typedef struct LogBackupCandidate {    // existing backup file found when subscribing
+    char *name;
+    uint64_t modifiedTime;  // nanoseconds on POSIX, 100 nanosecond units on Windows, only compared with each other
+    time_t closeTime;
+    uint64_t size;
+    bool isRotated;         // "name.log.<id>.rotated" left by process which stopped before rotation thread archived it
+} LogBackupCandidate;
+
+static atomic_uint lastFormatId;
+
+static AsyncMessage *asyncQueue = NULL;
+static size_t asyncQueueMask = 0;
+static _Alignas(64) atomic_size_t asyncEnqueuePosition;   // producers and consumer positions on separate cache lines
+static _Alignas(64) atomic_size_t asyncDequeuePosition;
+static _Alignas(64) atomic_uint asyncProducerCount;
+static atomic_uint asyncDroppedCount;
+static atomic_bool isAsyncRunning;
+static bool isAsyncStopping = false;    // backend thread is joined without lock, queue can't be replaced meanwhile
+static atomic_bool isDeferredFormatting;
+
+static _Atomic(LogRotationJob *) rotationJobs;  // lock-free stack, rotation thread takes all jobs at once
+static atomic_uint pendingRotationCount;
+static atomic_bool isRotationRunning;
+static uint32_t rotationSubscriberCount = 0;    // changed with configuration lock
+
 static bool isLockInitialized = false;
 #if defined(_WIN32) || defined(_WIN64)
 static CRITICAL_SECTION threadMutex;
@@ -29,29 +290,158 @@ static CRITICAL_SECTION threadMutex;
 static pthread_mutex_t threadMutex;
 #endif
 
+#if defined(_WIN32) || defined(_WIN64)
+static HANDLE asyncThread;
+static DWORD WINAPI asyncWorker(LPVOID argument);
+#else
+static pthread_t asyncThread;
+static void *asyncWorker(void *argument);
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+static HANDLE rotationThread;
+static DWORD WINAPI rotationWorker(LPVOID argument);
+#else
+static pthread_t rotationThread;
+static void *rotationWorker(void *argument);
+#endif
+
 static LoggerEvent *loggerSubscribe(LoggerEvent *event);
-static void consoleCallback(LoggerEvent *event, LogLevel severity);
-static void fileCallback(LoggerEvent *event, LogLevel severity);
-static void customCallback(LoggerEvent *event, LogLevel severity);
+static void removeSubscriber(LoggerEvent *subscriber);
+static void releaseSubscriber(LoggerEvent *subscriber);
+static const LoggerSnapshot *acquireSnapshot(unsigned int *parity);
+static void releaseSnapshot(unsigned int parity);
+static bool growSubscriberRegistry();
+static LoggerSnapshot *getSpareSnapshot();
+static void publishSnapshot(LoggerSnapshot *snapshot);
+static void waitForSnapshotReaders();
+static void consoleCallback(LoggerEvent *event, LogRecord *record);
+static void fileCallback(LoggerEvent *event, LogRecord *record);
+static void customCallback(LoggerEvent *event, LogRecord *record);
+static void binaryFileCallback(LoggerEvent *event, LogRecord *record);
+
+static void dispatchRecord(LogRecord *record);
+static bool isRecordAccepted(LogRecord *record);
+static bool isSubscriberTagAccepted(LoggerEvent *subscriber, LogRecord *record);
+static bool isRecordRepeated(LoggerEvent *subscriber, LogRecord *record);
+static void writeRepeatSummary(LoggerEvent *subscriber, LogRecord *record);
+static uint64_t hashRecord(const LogRecord *record);
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t length);
+static void captureRecordArguments(LogRecord *record, LoggerSite *site, const char *format, va_list list);
+static bool isRecordRenderNeeded(const LogRecord *record);
+static void logMessageList(LoggerSite *site, const char *tag, LogLevel severity, const char *format, va_list list);
+static bool enqueueAsyncMessage(LoggerSite *site, const char *tag, LogLevel severity, const char *format, va_list list);
+static bool dispatchAsyncMessage();
+static void reportDroppedMessages();
+static void sleepMicroseconds(uint32_t microseconds);
+static void lockAsyncState();
+static uint64_t nextRandom();
 
 static void initThreadLock();
 static void lockThread();
 static void unlockThread();
-
-static bool isNeedToBeLogged(LogLevel level);
-static uint32_t getLogFileSize(const char *fileName);
+static void initSubscriberLock(LoggerEvent *subscriber);
+static void destroySubscriberLock(LoggerEvent *subscriber);
+static void lockSubscriber(LoggerEvent *subscriber);
+static void unlockSubscriber(LoggerEvent *subscriber);
+
+static void updateDispatchState();
+static LogTagEntry *getTagEntry(const char *tag);
+static LogTagEntry *findTagEntry(const char *tag, uint32_t hash);
+static LogTagRule *findTagRule(const char *tag, bool isCreate);
+static LogTagRule *findTagRuleChild(const LogTagRule *rule, const char *segment, size_t length);
+static int8_t resolveTagLevel(const char *tag);
+static int getMinTagRuleLevel(const LogTagRule *rule, int level);
+static void updateTagLevels();
+static void setTagFilter(LoggerEvent *subscriber, _Atomic(LogTagFilter *) *filter, const char *const tags[], uint32_t count);
+static LogTagFilter *createTagFilter(const char *const tags[], uint32_t count);
+static bool isTagInFilter(const LogTagFilter *filter, const char *tag, uint32_t hash);
+static uint64_t getTagFilterBits(uint32_t hash);
+static uint64_t getLogFileSize(const char *fileName);
+static void syncLogFile(LoggerEvent *event, LogLevel severity, size_t length);
+static void flushLogFile(LoggerEvent *event);
+static void flushFileBuffers(bool isOnlyExpired);
+static uint64_t getMonotonicTimeMs();
 static bool rotateLogFiles(LoggerEvent *event);
-static void formatBackupFileName(const char *fileBaseName, char *backupFileName, size_t length);
+static bool openLogFile(LoggerEvent *event, bool isMovedAway);
+static bool archiveLogFile(LoggerEvent *event, const char *fileName, uint64_t size, time_t timestamp);
+static void removeExpiredBackupFiles(LoggerEvent *event);
+static time_t getBackupTimestamp(const LoggerEvent *event);
+static void updateRotationDeadline(LoggerEvent *event);
+static FILE *createStandbyFile(LoggerEvent *event);
+static LogRotationJob *createRotationJob(LoggerEvent *event);
+static bool switchLogFile(LoggerEvent *event, LogRotationJob *job);
+static void processRotationJobs(LogRotationJob *jobs);
+static bool startRotationWorker();
+static void stopRotationWorker();
+static void waitForRotationJobs();
+static void loadBackupFiles(LoggerEvent *event);
+static bool addBackupCandidate(LogBackupCandidate **candidates, uint32_t *count, uint32_t *capacity, size_t maxNameLength, const char *directory,
+                               size_t directoryLength, const char *name, uint64_t modifiedTime, time_t closeTime, uint64_t size, bool isRotated);
+static bool archiveRotatedFile(LoggerEvent *event, LogBackupCandidate *candidate, size_t maxNameLength);
+static bool isBackupFileName(const char *name, const char *baseName, size_t baseNameLength);
+static bool isRotatedFileName(const char *name, const char *fileBaseName);
+static bool skipDigits(const char **position, uint8_t count);
+static int compareBackupCandidates(const void *first, const void *second);
+static void formatBackupFileName(const char *fileBaseName, char *backupFileName, size_t length, time_t timestamp, bool isHourly);
 static bool isLogFileExist(const char *fileName);
+static bool isBackupNameTaken(const LoggerEvent *event, const char *name);
 static void shiftBackupFilesLeft(LogFile *files, uint8_t length);
-
-static size_t formatTimestamp(char *buffer);
+static LoggerEvent *subscribeFile(LogLevel threshold, const LogFileConfig *config, LoggerFunction function);
+
+static void writeBinaryData(LoggerEvent *event, const void *data, size_t length);
+static void writeBinaryHeader(LoggerEvent *event, struct timespec timestamp);
+static void writeBinaryTime(LoggerEvent *event, struct timespec timestamp);
+static void writeBinaryDictionaryEntry(LoggerEvent *event, LogBinaryEntryType type, uint16_t id, const char *text);
+static uint16_t writeBinaryTag(LoggerEvent *event, const char *tag);
+static void writeBinaryFormat(LoggerEvent *event, const LogFormat *format);
+static void resetBinaryDictionary(LogBinaryDictionary *dictionary);
+static void getBinaryTypeSizes(uint8_t *sizes);
+static uint32_t hashTag(const char *tag);
+static bool readBinaryData(FILE *input, void *data, size_t length);
+static char *readBinaryText(FILE *input, uint16_t *id);
+
+static struct tm *convertToLocalTime(time_t timestamp, struct tm *localTime);
+static void readRealTime(struct timespec *timestamp);
+static size_t formatTimestamp(char *buffer, struct timespec timestamp, LogTimestampPrecision precision);
+static char *writeTwoDigits(char *buffer, uint32_t value);
+static char *writeFixedDigits(char *buffer, uint32_t value, uint8_t digits);
 static size_t formatTagLevel(char *buffer, const char *tag, LogLevel severity, size_t timestampLength);
-static size_t formatLogMessage(char *buffer, const char *format, va_list list, size_t prefixLength);
+static void renderRecordPrefix(LogRecord *record, LogTimestampPrecision precision);
+static void completeRecord(LogRecord *record, size_t messageLength);
+static void renderRecord(LogRecord *record, const char *format, va_list list);
+static void renderMessage(LogRecord *record, const char *format, ...);
 int strCompareICase(const char *one, const char *two);
 
+static const LogFormat *getSiteFormat(LoggerSite *site, const char *format);
+static LogFormat *parseLogFormat(const char *format);
+static bool captureArguments(const LogFormat *format, va_list list, uint8_t *buffer, size_t capacity, uint16_t *length);
+static bool isCapturedArgumentsValid(const LogFormat *format, const uint8_t *arguments, size_t length);
+static size_t formatDeferredMessage(char *buffer, size_t size, const LogFormat *format, const uint8_t *arguments);
+
 
 LoggerEvent *subscribeFileLogger(LogLevel threshold, const char *fileName, uint32_t maxFileSize, uint8_t maxBackupFiles) {
+    LogFileConfig config = {.fileName = fileName, .maxFileSize = maxFileSize, .maxBackupFiles = maxBackupFiles};
+    return subscribeFileLoggerWithConfig(threshold, &config);
+}
+
+LoggerEvent *subscribeFileLoggerWithConfig(LogLevel threshold, const LogFileConfig *config) {
+    return subscribeFile(threshold, config, fileCallback);
+}
+
+LoggerEvent *subscribeBinaryFileLogger(LogLevel threshold, const LogFileConfig *config) {
+    return subscribeFile(threshold, config, binaryFileCallback);
+}
+
+static LoggerEvent *subscribeFile(LogLevel threshold, const LogFileConfig *config, LoggerFunction function) {
+    if (config == NULL) {
+        snprintf(ERROR_EVENT.buffer, LOGGER_BUFFER_SIZE, "ERROR: Mandatory parameter [config] is NULL");
+        return &ERROR_EVENT;
+    }
+
+    const char *fileName = config->fileName;
+    uint32_t maxFileSize = config->maxFileSize;
+    uint8_t maxBackupFiles = config->maxBackupFiles;
     if (fileName == NULL) {
         snprintf(ERROR_EVENT.buffer, LOGGER_BUFFER_SIZE, "ERROR: Mandatory parameter [fileName] is NULL");
         return &ERROR_EVENT;
@@ -72,7 +462,7 @@ LoggerEvent *subscribeFileLogger(LogLevel threshold, const char *fileName, uint3
     initThreadLock();
     lockThread();
 
-    LoggerEvent fileEvent = {.buffer = messageBuffer, .level = threshold, .function = fileCallback};
+    LoggerEvent fileEvent = {.buffer = messageBuffer, .level = threshold, .function = function};
     fileEvent.file = malloc(sizeof(struct LogFile));
     if (fileEvent.file == NULL) {
         snprintf(ERROR_EVENT.buffer, LOGGER_BUFFER_SIZE, "ERROR: Memory allocation fail while creating log file: [%s]", fileName);
@@ -89,12 +479,36 @@ LoggerEvent *subscribeFileLogger(LogLevel threshold, const char *fileName, uint3
         return &ERROR_EVENT;
     }
 
+    if (config->bufferSize > 0) {
+        fileEvent.writeBuffer = malloc(config->bufferSize);
+        if (fileEvent.writeBuffer == NULL) {
+            snprintf(ERROR_EVENT.buffer, LOGGER_BUFFER_SIZE, "ERROR: Write buffer memory allocation fail: [%s]", fileName);
+            fclose(fileEvent.file->out);
+            free(fileEvent.file);
+            unlockThread();
+            return &ERROR_EVENT;
+        }
+        fileEvent.writeBufferSize = config->bufferSize;
+        setvbuf(fileEvent.file->out, fileEvent.writeBuffer, _IOFBF, fileEvent.writeBufferSize);
+    }
+
     fileEvent.file->size = getLogFileSize(fileName);
     fileEvent.file->name = calloc(fileNameLength, sizeof(char));
     fileEvent.backupFiles = calloc(maxBackupFiles, sizeof(struct LogFile));
-    if (fileEvent.file->name == NULL || fileEvent.backupFiles == NULL) {
+    if (function == binaryFileCallback) {
+        fileEvent.dictionary = calloc(1, sizeof(struct LogBinaryDictionary));
+    }
+#if !defined(_WIN32) && !defined(_WIN64)
+    fileEvent.isStandbyFile = config->isStandbyFile && maxBackupFiles > 0;  // open file can't be renamed on Windows
+    fileEvent.isStandbyPreallocated = config->isStandbyPreallocated;
+    if (fileEvent.isStandbyFile) {
+        fileEvent.standbyName = malloc(fileNameLength + sizeof(STANDBY_NAME_SUFFIX));
+    }
+#endif
+    if (fileEvent.file->name == NULL || fileEvent.backupFiles == NULL || (function == binaryFileCallback && fileEvent.dictionary == NULL) ||
+        (fileEvent.isStandbyFile && fileEvent.standbyName == NULL)) {
         snprintf(ERROR_EVENT.buffer, LOGGER_BUFFER_SIZE, "ERROR: Memory allocation fail: [%s]", fileName);
-        loggerUnsubscribe(&fileEvent);
+        releaseSubscriber(&fileEvent);
         unlockThread();
         return &ERROR_EVENT;
     }
@@ -104,7 +518,7 @@ LoggerEvent *subscribeFileLogger(LogLevel threshold, const char *fileName, uint3
         fileEvent.backupFiles[i].name = calloc(fileNameLength + FILE_TIMESTAMP_LENGTH, sizeof(char));
         if (fileEvent.backupFiles[i].name == NULL) {
             snprintf(ERROR_EVENT.buffer, LOGGER_BUFFER_SIZE, "ERROR: Backup memory allocation fail: [%s]", fileName);
-            loggerUnsubscribe(&fileEvent);
+            releaseSubscriber(&fileEvent);
             unlockThread();
             return &ERROR_EVENT;
         }
@@ -113,8 +527,27 @@ LoggerEvent *subscribeFileLogger(LogLevel threshold, const char *fileName, uint3
     strncpy(fileEvent.file->name, fileName, fileNameLength);
     fileEvent.file->maxSize = maxFileSize > 0 ? maxFileSize : DEFAULT_FILE_SIZE;
     fileEvent.maxBackupFiles = maxBackupFiles;
-    LoggerEvent *logEvent = loggerSubscribe(&fileEvent);
+    fileEvent.maxTotalSize = config->maxTotalSize;
+    fileEvent.maxBackupAgeSec = config->maxBackupAgeSec;
+    fileEvent.rotationPeriod = maxBackupFiles > 0 ? config->rotationPeriod : LOG_ROTATION_NONE;
+    loadBackupFiles(&fileEvent);
+    fileEvent.rotationIntervalMs = config->rotationIntervalMs;
+    updateRotationDeadline(&fileEvent);
+    fileEvent.syncPolicy = config->sync;
+    fileEvent.lastSyncTime = getMonotonicTimeMs();
+    fileEvent.flushIntervalMs = config->flushIntervalMs;
+    fileEvent.lastFlushTime = fileEvent.lastSyncTime;
+    fileEvent.isBackgroundRotation = (config->isBackgroundRotation || fileEvent.isStandbyFile) && startRotationWorker();    // falls back to rotation by log call
+    fileEvent.isStandbyFile = fileEvent.isStandbyFile && fileEvent.isBackgroundRotation;   // next standby is created only by rotation thread
+    if (fileEvent.isStandbyFile) {
+        snprintf(fileEvent.standbyName, fileNameLength + sizeof(STANDBY_NAME_SUFFIX), "%s%s", fileName, STANDBY_NAME_SUFFIX);
+        fileEvent.standbyOut = createStandbyFile(&fileEvent);
+    }
     memset(messageBuffer, 0, LOGGER_BUFFER_SIZE);
+    LoggerEvent *logEvent = loggerSubscribe(&fileEvent);
+    if (logEvent == &ERROR_EVENT && fileEvent.isBackgroundRotation) {
+        stopRotationWorker();
+    }
     unlockThread();
     return logEvent;
 }
@@ -148,6 +581,49 @@ LoggerEvent *subscribeCustomLogger(LogLevel threshold, LoggerCallback callback)
 
 void loggerUnsubscribe(LoggerEvent *subscriber) {
     if (subscriber == NULL || subscriber == &ERROR_EVENT) return;
+    initThreadLock();
+    lockThread();
+    if (subscriber->isSubscribed) {     // handle which is already unsubscribed is ignored
+        removeSubscriber(subscriber);
+    }
+    unlockThread();
+}
+
+void loggerUnsubscribeAll() {
+    initThreadLock();
+    loggerFlush();
+    lockThread();
+    while (subscriberCount > 0) {
+        removeSubscriber(subscriberRegistry[subscriberCount - 1]);
+    }
+    unlockThread();
+}
+
+static void removeSubscriber(LoggerEvent *subscriber) {
+    LoggerEvent *lastSubscriber = subscriberRegistry[--subscriberCount];
+    subscriberRegistry[subscriber->registryIndex] = lastSubscriber;
+    lastSubscriber->registryIndex = subscriber->registryIndex;
+    subscriber->isSubscribed = false;
+
+    publishSnapshot(getSpareSnapshot());  // waits until no thread is dispatching to this subscriber
+    if (subscriber->isBackgroundRotation) {
+        waitForRotationJobs();  // rotation thread doesn't use subscriber after this
+    }
+    releaseSubscriber(subscriber);
+    if (subscriber->isBackgroundRotation) {
+        stopRotationWorker();
+    }
+    destroySubscriberLock(subscriber);
+    subscriber->nextRetired = retiredSubscribers;
+    retiredSubscribers = subscriber;
+}
+
+static void releaseSubscriber(LoggerEvent *subscriber) {
+    if (subscriber->deduplicator != NULL) {
+        writeRepeatSummary(subscriber, NULL);
+        free(subscriber->deduplicator);
+        subscriber->deduplicator = NULL;
+    }
 
     if (subscriber->file != NULL) {
         if (subscriber->file->out != NULL) {
@@ -160,15 +636,11 @@ void loggerUnsubscribe(LoggerEvent *subscriber) {
         }
     }
 
-    for (uint8_t i = 0; i < subscriber->maxBackupFiles; i++) {
+    for (uint8_t i = 0; i < subscriber->maxBackupFiles; i++) {   // backup files are never kept open
         if (subscriber->backupFiles[i].name != NULL) {
             free(subscriber->backupFiles[i].name);
             subscriber->backupFiles[i].name = NULL;
         }
-
-        if (subscriber->backupFiles[i].out != NULL) {
-            fclose(subscriber->backupFiles[i].out);
-        }
     }
 
     if (subscriber->file != NULL) {
@@ -181,34 +653,251 @@ void loggerUnsubscribe(LoggerEvent *subscriber) {
         subscriber->backupFiles = NULL;
     }
 
+    if (subscriber->dictionary != NULL) {
+        resetBinaryDictionary(subscriber->dictionary);
+        free(subscriber->dictionary->writtenFormats);
+        free(subscriber->dictionary);
+        subscriber->dictionary = NULL;
+    }
+
+    if (subscriber->writeBuffer != NULL) {  // file is already closed and buffer written out
+        free(subscriber->writeBuffer);
+        subscriber->writeBuffer = NULL;
+    }
+    free(subscriber->spareWriteBuffer);
+    subscriber->spareWriteBuffer = NULL;
+
+    if (subscriber->standbyOut != NULL) {   // unused standby file is empty
+        fclose(subscriber->standbyOut);
+        subscriber->standbyOut = NULL;
+        remove(subscriber->standbyName);
+    }
+    free(subscriber->standbyName);
+    subscriber->standbyName = NULL;
+
+    free(atomic_exchange(&subscriber->allowedTags, NULL));
+    free(atomic_exchange(&subscriber->deniedTags, NULL));
+
     subscriber->maxBackupFiles = 0;
-    subscriber->isSubscribed = false;
+}
 
-    for (uint8_t i = 0; i < LOGGER_MAX_SUBSCRIBERS; i++) {  // Reorganize subscribers, active should be first
-        LoggerEvent *event = &loggerSubscriberArray[i];
-        if (!event->isSubscribed && (i + 1) < LOGGER_MAX_SUBSCRIBERS) {
-            LoggerEvent *nextEvent = &loggerSubscriberArray[i + 1];
-            if (nextEvent->isSubscribed) {
-                loggerSubscriberArray[i] = *nextEvent;
-                loggerSubscriberArray[i + 1] = (LoggerEvent){0};
-            }
-        }
+void loggerSetLevel(LoggerEvent *subscriber, LogLevel threshold) {
+    if (subscriber == NULL || subscriber == &ERROR_EVENT) return;
+    initThreadLock();
+    lockThread();
+    subscriber->level = threshold;
+    if (subscriber->isSubscribed) {
+        publishSnapshot(getSpareSnapshot());    // rebuild dispatch lists of each level
     }
+    unlockThread();
 }
 
-void loggerUnsubscribeAll() {
+void loggerSetTagLevel(const char *tag, LogLevel threshold) {
+    if (tag == NULL) return;
     initThreadLock();
     lockThread();
-    for (uint8_t i = 0; i < LOGGER_MAX_SUBSCRIBERS; i++) {
-        LoggerEvent *subscriber = &loggerSubscriberArray[i];
-        if (!subscriber->isSubscribed) {
-            break;
+    LogTagRule *rule = findTagRule(tag, true);
+    if (rule != NULL) {
+        rule->level = (int8_t) threshold;
+        updateTagLevels();
+    } else {
+        fprintf(stderr, "ERROR: Memory allocation fail, level of tag: [%s] is not set\n", tag);
+    }
+    unlockThread();
+}
+
+void loggerClearTagLevel(const char *tag) {
+    if (tag == NULL) return;
+    initThreadLock();
+    lockThread();
+    LogTagRule *rule = findTagRule(tag, false);
+    if (rule != NULL) {
+        rule->level = -1;
+        updateTagLevels();
+    }
+    unlockThread();
+}
+
+void loggerSetDefaultTagLevel(LogLevel threshold) {
+    initThreadLock();
+    lockThread();
+    atomic_store(&defaultTagLevel, (signed char) threshold);
+    updateTagLevels();
+    unlockThread();
+}
+
+void loggerAllowTags(LoggerEvent *subscriber, const char *const tags[], uint32_t count) {
+    if (subscriber == NULL || subscriber == &ERROR_EVENT) return;
+    initThreadLock();
+    lockThread();
+    if (subscriber->isSubscribed) {
+        setTagFilter(subscriber, &subscriber->allowedTags, tags, count);
+    }
+    unlockThread();
+}
+
+void loggerDenyTags(LoggerEvent *subscriber, const char *const tags[], uint32_t count) {
+    if (subscriber == NULL || subscriber == &ERROR_EVENT) return;
+    initThreadLock();
+    lockThread();
+    if (subscriber->isSubscribed) {
+        setTagFilter(subscriber, &subscriber->deniedTags, tags, count);
+    }
+    unlockThread();
+}
+
+void loggerEnableDeduplication(LoggerEvent *subscriber, uint32_t windowMs) {
+    if (subscriber == NULL || subscriber == &ERROR_EVENT) return;
+    initThreadLock();
+    lockThread();
+    if (!subscriber->isSubscribed) {    // lock of unsubscribed record is destroyed
+        unlockThread();
+        return;
+    }
+    lockSubscriber(subscriber);
+    if (windowMs == 0 && subscriber->deduplicator != NULL) {
+        writeRepeatSummary(subscriber, NULL);
+        free(subscriber->deduplicator);
+        subscriber->deduplicator = NULL;
+    } else if (windowMs > 0 && subscriber->deduplicator == NULL) {
+        subscriber->deduplicator = calloc(1, sizeof(struct LogDeduplicator));
+        if (subscriber->deduplicator == NULL) {
+            fprintf(stderr, "ERROR: Memory allocation fail, deduplication of subscriber is not enabled\n");
+        }
+    }
+
+    if (subscriber->deduplicator != NULL) {
+        subscriber->deduplicator->windowMs = windowMs;
+    }
+    unlockSubscriber(subscriber);
+    unlockThread();
+}
+
+bool loggerIsTagEnabled(LoggerSite *site, const char *tag, LogLevel level) {
+    LogTagEntry *entry = getTagEntry(tag);
+    if (entry == NULL) {    // table is full, rules are resolved on every call
+        if (tag == NULL) {
+            return (int) level >= atomic_load_explicit(&defaultTagLevel, memory_order_relaxed);
+        }
+        initThreadLock();
+        lockThread();
+        int8_t tagLevel = resolveTagLevel(tag);
+        unlockThread();
+        return (int) level >= tagLevel;
+    }
+
+    LogTagEntry *expectedEntry = NULL;
+    if (site != NULL && atomic_compare_exchange_strong(&site->tagEntry, &expectedEntry, entry)) {
+        atomic_store_explicit(&site->tag, tag, memory_order_release);    // only the first tag of site is cached
+    }
+    return (int) level >= atomic_load_explicit(&entry->level, memory_order_relaxed);
+}
+
+bool loggerStartAsync(uint32_t queueSize) {
+    lockAsyncState();   // concurrent start or stop would create second queue and thread
+    if (atomic_load(&isAsyncRunning)) {
+        unlockThread();
+        return true;
+    }
+
+    size_t capacity = 1;
+    size_t requestedCapacity = queueSize > 0 ? queueSize : LOGGER_ASYNC_QUEUE_SIZE;
+    while (capacity < requestedCapacity) {
+        capacity <<= 1;
+    }
+
+    asyncQueue = malloc(capacity * sizeof(struct AsyncMessage));
+    if (asyncQueue == NULL) {
+        fprintf(stderr, "ERROR: Memory allocation fail for asynchronous queue: [%zu]\n", capacity);
+        unlockThread();
+        return false;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&asyncQueue[i].sequence, i);
+    }
+    asyncQueueMask = capacity - 1;
+    atomic_store(&asyncEnqueuePosition, 0);
+    atomic_store(&asyncDequeuePosition, 0);
+    atomic_store(&asyncDroppedCount, 0);
+    atomic_store(&isAsyncRunning, true);
+
+#if defined(_WIN32) || defined(_WIN64)
+    asyncThread = CreateThread(NULL, 0, asyncWorker, NULL, 0, NULL);
+    bool isThreadStarted = asyncThread != NULL;
+#else
+    bool isThreadStarted = pthread_create(&asyncThread, NULL, asyncWorker, NULL) == 0;
+#endif
+    if (!isThreadStarted) {
+        fprintf(stderr, "ERROR: Failed to start asynchronous logger thread\n");
+        atomic_store(&isAsyncRunning, false);
+        while (atomic_load(&asyncProducerCount) > 0) {  // producers may already publish into the queue
+            sleepMicroseconds(LOGGER_ASYNC_IDLE_SLEEP_US);
+        }
+        while (dispatchAsyncMessage()) {    // there is no backend thread, so messages already queued are written here
         }
-        loggerUnsubscribe(subscriber);
+        reportDroppedMessages();
+        free(asyncQueue);
+        asyncQueue = NULL;
+        unlockThread();
+        return false;
+    }
+    unlockThread();
+    return true;
+}
+
+void loggerStopAsync() {
+    lockAsyncState();   // only one caller joins the backend thread and frees the queue
+    if (!atomic_load(&isAsyncRunning)) {
+        unlockThread();
+        return;
     }
+    atomic_store(&isAsyncRunning, false);   // new messages are logged synchronously, backend drains the rest and exits
+    isAsyncStopping = true;
+    unlockThread();     // callbacks on backend thread may take the lock, e.g. for a new tag
+
+#if defined(_WIN32) || defined(_WIN64)
+    WaitForSingleObject(asyncThread, INFINITE);
+    CloseHandle(asyncThread);
+#else
+    pthread_join(asyncThread, NULL);
+#endif
+    free(asyncQueue);
+    asyncQueue = NULL;
+    lockThread();
+    isAsyncStopping = false;
     unlockThread();
 }
 
+void loggerSetDeferredFormatting(bool isEnabled) {
+    atomic_store(&isDeferredFormatting, isEnabled);
+}
+
+bool loggerIsIntervalElapsed(atomic_uint_least64_t *lastTimeMs, uint32_t intervalMs) {
+    uint64_t now = getMonotonicTimeMs() + 1;    // 0 is reserved for call site that never logged
+    uint64_t lastTime = atomic_load_explicit(lastTimeMs, memory_order_relaxed);
+    if (lastTime != 0 && now - lastTime < intervalMs) {
+        return false;
+    }
+    return atomic_compare_exchange_strong_explicit(lastTimeMs, &lastTime, now, memory_order_relaxed, memory_order_relaxed);   // only one thread wins the interval
+}
+
+bool loggerIsSampled(double probability) {
+    return (double) (nextRandom() >> 11) * 0x1.0p-53 < probability;     // 53 random bits as fraction in [0, 1)
+}
+
+void loggerFlush() {
+    if (atomic_load(&isAsyncRunning)) {
+        size_t position = atomic_load(&asyncEnqueuePosition);
+        while (atomic_load(&isAsyncRunning) && atomic_load(&asyncDequeuePosition) < position) {
+            sleepMicroseconds(LOGGER_ASYNC_IDLE_SLEEP_US);
+        }
+    }
+
+    waitForRotationJobs();  // rotated files are written out when rotation thread closes them
+    flushFileBuffers(false);
+}
+
 const char *logLevelToString(LogLevel severity) {
     return severity <= LOG_LEVEL_FATAL ? LEVEL_STRINGS[severity] : LEVEL_STRINGS[LOG_LEVEL_UNKNOWN];
 }
@@ -237,189 +926,1442 @@ LogLevel stringToLogLevel(const char *severity) {
     }
 }
 
-void logMessage(const char *tag, LogLevel severity, const char *format, ...) {
-    lockThread();
-    if (!isNeedToBeLogged(severity)) {
-        unlockThread();
-        return;
+void loggerSetTimestampPrecision(LogTimestampPrecision precision) {
+    if (precision <= LOG_TIMESTAMP_NANOSECONDS) {
+        atomic_store(&timestampPrecision, precision);
     }
+}
 
-    for (uint8_t i = 0; i < LOGGER_MAX_SUBSCRIBERS; i++) {
-        LoggerEvent *subscriber = &loggerSubscriberArray[i];
-        if (!subscriber->isSubscribed) {
-            break;
-        }
-
-        if (severity >= subscriber->level) {
-            va_start(subscriber->list, format);
-            subscriber->tag = tag;
-            subscriber->format = format;
-            subscriber->function(subscriber, severity);
-            va_end(subscriber->list);
-        }
-    }
+void logMessage(const char *tag, LogLevel severity, const char *format, ...) {
+    va_list list;
+    va_start(list, format);
+    logMessageList(NULL, tag, severity, format, list);
+    va_end(list);
+}
 
-    memset(messageBuffer, 0, strlen(messageBuffer));
-    unlockThread();
+void logSiteMessage(LoggerSite *site, const char *tag, LogLevel severity, const char *format, ...) {
+    va_list list;
+    va_start(list, format);
+    logMessageList(site, tag, severity, format, list);
+    va_end(list);
 }
 
 static LoggerEvent *loggerSubscribe(LoggerEvent *event) {
-    for (uint8_t i = 0; i < LOGGER_MAX_SUBSCRIBERS; i++) {
-        LoggerEvent *subscriber = &loggerSubscriberArray[i];
-        if (!subscriber->isSubscribed) {
-            *subscriber = *event;
-            subscriber->isSubscribed = true;
-            return subscriber;
-        }
+    LoggerEvent *subscriber = malloc(sizeof(struct LoggerEvent));   // allocated separately, so pointer stays valid after unsubscribe
+    if (subscriber == NULL || (subscriberCount == subscriberCapacity && !growSubscriberRegistry())) {
+        snprintf(ERROR_EVENT.buffer, LOGGER_BUFFER_SIZE, "ERROR: Memory allocation fail while subscribing logger");
+        releaseSubscriber(event);
+        free(subscriber);
+        return &ERROR_EVENT;
     }
-    return NULL;
-}
 
-static void consoleCallback(LoggerEvent *event, LogLevel severity) {
-    size_t timestampLength = formatTimestamp(event->buffer);
-#ifdef USE_LOGGER_COLOR
-    size_t tagLevelLength = formatColoredTagLevel(event->buffer, event->tag, severity, timestampLength);
-#else
-    size_t tagLevelLength = formatTagLevel(event->buffer, event->tag, severity, timestampLength);
-#endif
+    *subscriber = *event;
+    subscriber->isSubscribed = true;
+    subscriber->registryIndex = subscriberCount;
+    initSubscriberLock(subscriber);
+    subscriberRegistry[subscriberCount++] = subscriber;
 
-    size_t totalMessageLength = formatLogMessage(event->buffer, event->format, event->list, (timestampLength + tagLevelLength));
-    printf("%s", event->buffer);
-    memset(event->buffer, 0, totalMessageLength);
+    publishSnapshot(getSpareSnapshot());
+    return subscriber;
 }
 
-static void fileCallback(LoggerEvent *event, LogLevel severity) {
-    if (rotateLogFiles(event)) {
-        size_t timestampLength = formatTimestamp(event->buffer);
-        size_t tagLevelLength = formatTagLevel(event->buffer, event->tag, severity, timestampLength);
-        size_t totalMessageLength = formatLogMessage(event->buffer, event->format, event->list, (timestampLength + tagLevelLength));
-
-        fwrite(event->buffer, sizeof(char), totalMessageLength, event->file->out);
-    #if defined(_WIN32) || defined(_WIN64)
-        fflush(event->file->out);
-    #else
-        fflush(event->file->out);
-        fsync(fileno(event->file->out));
-    #endif /* defined(_WIN32) || defined(_WIN64) */
-        event->file->size += totalMessageLength;
-        memset(event->buffer, 0, totalMessageLength);
+static bool growSubscriberRegistry() {     // snapshot buffers are allocated along with registry, so removal never allocates
+    uint32_t capacity = subscriberCapacity > 0 ? subscriberCapacity * 2 : LOGGER_MAX_SUBSCRIBERS;
+    LoggerEvent **registry = realloc(subscriberRegistry, capacity * sizeof(LoggerEvent *));
+    if (registry == NULL) {
+        return false;
+    }
+    subscriberRegistry = registry;
+
+    size_t bufferSize = sizeof(LoggerSnapshot) + (size_t) capacity * (LOG_LEVEL_COUNT + 1) * sizeof(LoggerEvent *);
+    LoggerSnapshot *firstBuffer = malloc(bufferSize);
+    LoggerSnapshot *secondBuffer = malloc(bufferSize);
+    if (firstBuffer == NULL || secondBuffer == NULL) {
+        free(firstBuffer);
+        free(secondBuffer);
+        return false;
     }
-}
 
-static void customCallback(LoggerEvent *event, LogLevel severity) {
-    size_t timestampLength = formatTimestamp(event->buffer);
-    size_t tagLevelLength = formatTagLevel(event->buffer, event->tag, severity, timestampLength);
-    size_t totalMessageLength = formatLogMessage(event->buffer, event->format, event->list, (timestampLength + tagLevelLength));
-    event->callback(severity, event->buffer, totalMessageLength);
-    memset(event->buffer, 0, totalMessageLength);
+    publishSnapshot(firstBuffer);   // move readers to new buffer before old ones are released
+    free(snapshotBuffers[0]);
+    free(snapshotBuffers[1]);
+    snapshotBuffers[0] = firstBuffer;
+    snapshotBuffers[1] = secondBuffer;
+    subscriberCapacity = capacity;
+    return true;
 }
 
-static void initThreadLock() {
-    if (isLockInitialized) return;
-#if defined(_WIN32) || defined(_WIN64)
-    InitializeCriticalSection(&threadMutex);
-#else
-    pthread_mutex_init(&threadMutex, NULL);
-#endif
-    isLockInitialized = true;
+static const LoggerSnapshot *acquireSnapshot(unsigned int *parity) {
+    if (readerSlot == NULL) {
+        readerSlot = &snapshotReaderSlots[atomic_fetch_add(&lastReaderSlot, 1) % SNAPSHOT_READER_SLOTS];
+    }
+    *parity = atomic_load(&snapshotEpoch) & 1;
+    atomic_fetch_add(&readerSlot->readers[*parity], 1);
+    return atomic_load(&currentSnapshot);
 }
 
-static void lockThread() {
-#if defined(_WIN32) || defined(_WIN64)
-    EnterCriticalSection(&threadMutex);
-#else
-    pthread_mutex_lock(&threadMutex);
-#endif /* defined(_WIN32) || defined(_WIN64) */
+static void releaseSnapshot(unsigned int parity) {  // called by the thread which acquired snapshot
+    atomic_fetch_sub(&readerSlot->readers[parity], 1);
 }
 
-static void unlockThread() {
-#if defined(_WIN32) || defined(_WIN64)
-    LeaveCriticalSection(&threadMutex);
-#else
-    pthread_mutex_unlock(&threadMutex);
-#endif /* defined(_WIN32) || defined(_WIN64) */
+static LoggerSnapshot *getSpareSnapshot() {
+    return atomic_load(&currentSnapshot) == snapshotBuffers[0] ? snapshotBuffers[1] : snapshotBuffers[0];
 }
 
-static bool isNeedToBeLogged(LogLevel level) {
-    for(uint32_t i = 0; i < LOGGER_MAX_SUBSCRIBERS; i++) {
-        LoggerEvent *subscriber = &loggerSubscriberArray[i];
-        if (!subscriber->isSubscribed) {
-            return false;
-        }
-
-        if (level >= subscriber->level) {
-            return true;
+static void publishSnapshot(LoggerSnapshot *snapshot) {   // called with configuration lock, snapshot is the buffer not used by readers
+    snapshot->count = subscriberCount;
+    memcpy(snapshot->subscribers, subscriberRegistry, subscriberCount * sizeof(LoggerEvent *));
+    uint32_t position = subscriberCount;
+    for (uint8_t level = 0; level < LOG_LEVEL_COUNT; level++) {  // dispatch list for each level is built once here
+        snapshot->levelOffsets[level] = position;
+        for (uint32_t i = 0; i < subscriberCount; i++) {
+            if (level >= subscriberRegistry[i]->level) {
+                snapshot->subscribers[position++] = subscriberRegistry[i];
+            }
         }
     }
-    return false;
+    snapshot->levelOffsets[LOG_LEVEL_COUNT] = position;
+    atomic_store(&currentSnapshot, snapshot);
+    updateDispatchState();
+    waitForSnapshotReaders();   // old snapshot buffer can be reused and removed subscriber released after this
 }
 
-static uint32_t getLogFileSize(const char *fileName) {
-    FILE *logFile;
-    if ((logFile = fopen(fileName, "rb")) == NULL) {
-        return 0;
+static void waitForSnapshotReaders() {
+    for (uint8_t i = 0; i < 2; i++) {   // new readers enter with other parity, so waiting never starves
+        unsigned int parity = atomic_fetch_add(&snapshotEpoch, 1) & 1;
+        for (uint32_t slot = 0; slot < SNAPSHOT_READER_SLOTS; slot++) {     // writer pays for scanning, readers don't share counter
+            while (atomic_load(&snapshotReaderSlots[slot].readers[parity]) != 0) {
+                sleepMicroseconds(SNAPSHOT_WAIT_SLEEP_US);
+            }
+        }
     }
-    fseek(logFile, 0, SEEK_END);
-    uint32_t fileSize = ftell(logFile);
-    fclose(logFile);
-    return fileSize;
 }
 
-static bool rotateLogFiles(LoggerEvent *event) {
-    if (event->file->size <= event->file->maxSize) {
-        return event->file->out != NULL;
+static void logMessageList(LoggerSite *site, const char *tag, LogLevel severity, const char *format, va_list list) {
+    if (!loggerIsLevelEnabled(severity)) {  // no subscriber accepts this level, skip without locking
+        return;
     }
 
-    if (event->maxBackupFiles == 0) {
-        fprintf(stderr, "ERROR: Log file is full: [%s]\n", event->file->name);
-        return false;
+    if (site == NULL && !loggerIsTagEnabled(NULL, tag, severity)) {     // macros check tag level before call
+        return;
     }
-    fclose(event->file->out);
 
-    LogFile backupFile = event->backupFiles[0];  // first is the NULL or oldest backup file
-    if (backupFile.out != NULL && remove(backupFile.name) != 0) {   // remove already existing file
-        fprintf(stderr, "ERROR: Failed to remove backup log file: [%s]\n", backupFile.name);
+    if (atomic_load(&isAsyncRunning)) {
+        atomic_fetch_add(&asyncProducerCount, 1);   // keeps the queue alive until message is published
+        if (atomic_load(&isAsyncRunning)) {
+            if (!enqueueAsyncMessage(site, tag, severity, format, list)) {
+                atomic_fetch_add(&asyncDroppedCount, 1);
+            }
+            atomic_fetch_sub(&asyncProducerCount, 1);
+            return;
+        }
+        atomic_fetch_sub(&asyncProducerCount, 1);
     }
 
-    size_t length = strlen(event->file->name) + FILE_TIMESTAMP_LENGTH;
-    formatBackupFileName(event->file->name, backupFile.name, length);
-    if (isLogFileExist(backupFile.name)) {
-        sprintf(backupFile.name + strlen(backupFile.name), ".%d", backupFile.id);  // log file with same timestamp already exist, so add unique id
-        if (isLogFileExist(backupFile.name) && remove(backupFile.name) != 0) {  // if it still exists, then remove it
-            fprintf(stderr, "ERROR: Failed to remove backup log file: [%s]\n", backupFile.name);
-        }
+    LogRecord record = {.tag = tag, .severity = severity, .line = lineBuffer};
+    if (atomic_load_explicit(&hasTagFilter, memory_order_relaxed) && !isRecordAccepted(&record)) {
+        return;     // every subscriber filters out this tag, skip formatting
     }
 
-    if (rename(event->file->name, backupFile.name) != 0) {
-        fprintf(stderr, "ERROR: Failed to rename log file. From [%s] to [%s]\n", event->file->name, backupFile.name);
+    readRealTime(&record.timestamp);
+    if (site != NULL && atomic_load_explicit(&hasBinarySubscriber, memory_order_relaxed)) {
+        captureRecordArguments(&record, site, format, list);
     }
-    backupFile.size = event->file->size;
-    backupFile.maxSize = event->file->maxSize;
-    backupFile.out = fopen(backupFile.name, "r");
-    if (backupFile.out == NULL) {
-        fprintf(stderr, "ERROR: Failed to open backup log file: [%s]\n", backupFile.name);
+    if (isRecordRenderNeeded(&record)) {
+        renderRecord(&record, format, list);
     }
-    fclose(backupFile.out);
 
-    shiftBackupFilesLeft(event->backupFiles, event->maxBackupFiles);    // move backups
-    event->backupFiles[event->maxBackupFiles - 1] = backupFile;  // put the newest backup file to the end of array
-    event->file->out = fopen(event->file->name, "a"); // create empty file with original log file name
-    if (event->file->out == NULL) {
-        fprintf(stderr, "ERROR: Failed to open log file: [%s]\n", event->file->name);
-        return false;
-    }
-    event->file->size = getLogFileSize(event->file->name);
-    return true;
+    dispatchRecord(&record);
 }
 
-static void formatBackupFileName(const char *fileBaseName, char *backupFileName, size_t length) {   // Example: "dir1/dir2/fileName.log" -> "dir1/dir2/fileName_2023-05-02.log"
+static void captureRecordArguments(LogRecord *record, LoggerSite *site, const char *format, va_list list) {
+    const LogFormat *siteFormat = getSiteFormat(site, format);
+    if (siteFormat == NULL || siteFormat->id == 0) {
+        return;
+    }
+
+    va_list arguments;
+    va_copy(arguments, list);
+    if (captureArguments(siteFormat, arguments, argumentBuffer, LOGGER_BUFFER_SIZE, &record->argumentsLength)) {
+        record->format = siteFormat;
+        record->arguments = argumentBuffer;
+    }
+    va_end(arguments);
+}
+
+static bool isRecordRenderNeeded(const LogRecord *record) {     // binary file logger needs only captured arguments
+    return record->format == NULL || record->format->id == 0 || atomic_load_explicit(&hasTextSubscriber, memory_order_relaxed);
+}
+
+static void dispatchRecord(LogRecord *record) {
+    unsigned int parity;
+    const LoggerSnapshot *snapshot = acquireSnapshot(&parity);
+    uint8_t level = record->severity <= LOG_LEVEL_FATAL ? record->severity : LOG_LEVEL_FATAL;
+    uint32_t end = snapshot->levelOffsets[level + 1];
+    for (uint32_t i = snapshot->levelOffsets[level]; i < end; i++) {
+        LoggerEvent *subscriber = snapshot->subscribers[i];
+        if (!isSubscriberTagAccepted(subscriber, record)) {
+            continue;
+        }
+        lockSubscriber(subscriber);
+        if (subscriber->deduplicator == NULL || !isRecordRepeated(subscriber, record)) {
+            subscriber->function(subscriber, record);
+        }
+        unlockSubscriber(subscriber);
+    }
+    releaseSnapshot(parity);
+}
+
+static bool isRecordAccepted(LogRecord *record) {
+    unsigned int parity;
+    const LoggerSnapshot *snapshot = acquireSnapshot(&parity);
+    uint8_t level = record->severity <= LOG_LEVEL_FATAL ? record->severity : LOG_LEVEL_FATAL;
+    uint32_t end = snapshot->levelOffsets[level + 1];
+    bool isAccepted = false;
+    for (uint32_t i = snapshot->levelOffsets[level]; i < end && !isAccepted; i++) {
+        isAccepted = isSubscriberTagAccepted(snapshot->subscribers[i], record);
+    }
+    releaseSnapshot(parity);
+    return isAccepted;
+}
+
+static bool isSubscriberTagAccepted(LoggerEvent *subscriber, LogRecord *record) {   // called with acquired snapshot, so filters stay valid
+    const LogTagFilter *allowedTags = atomic_load_explicit(&subscriber->allowedTags, memory_order_acquire);
+    const LogTagFilter *deniedTags = atomic_load_explicit(&subscriber->deniedTags, memory_order_acquire);
+    if (allowedTags == NULL && deniedTags == NULL) {
+        return true;
+    }
+
+    const char *tag = record->tag != NULL ? record->tag : "";
+    if (!record->isTagHashed) {
+        record->tagHash = hashTag(tag);
+        record->isTagHashed = true;
+    }
+    return (allowedTags == NULL || isTagInFilter(allowedTags, tag, record->tagHash)) &&
+           (deniedTags == NULL || !isTagInFilter(deniedTags, tag, record->tagHash));
+}
+
+static bool isRecordRepeated(LoggerEvent *subscriber, LogRecord *record) {  // called with subscriber lock
+    LogDeduplicator *deduplicator = subscriber->deduplicator;
+    if (!record->isMessageHashed) {
+        record->messageHash = hashRecord(record);
+        record->isMessageHashed = true;
+    }
+
+    uint64_t now = getMonotonicTimeMs();
+    if (deduplicator->hasLastMessage && deduplicator->lastHash == record->messageHash && now - deduplicator->streakStartTime < deduplicator->windowMs) {
+        deduplicator->repeatCount++;
+        return true;
+    }
+
+    writeRepeatSummary(subscriber, record);     // streak ended or window elapsed
+    deduplicator->hasLastMessage = true;
+    deduplicator->lastHash = record->messageHash;
+    deduplicator->streakStartTime = now;
+    deduplicator->severity = record->severity;
+    snprintf(deduplicator->tag, DEDUPLICATION_TAG_SIZE, "%s", record->tag != NULL ? record->tag : "");
+    return false;
+}
+
+static void writeRepeatSummary(LoggerEvent *subscriber, LogRecord *record) {    // record is dispatched right after summary, NULL if none
+    LogDeduplicator *deduplicator = subscriber->deduplicator;
+    if (deduplicator->repeatCount == 0) {
+        return;
+    }
+
+    LogRecord summary = {.tag = deduplicator->tag, .severity = deduplicator->severity, .line = summaryLineBuffer};
+    readRealTime(&summary.timestamp);
+    renderMessage(&summary, "Last message repeated [%u] times", deduplicator->repeatCount);
+    deduplicator->repeatCount = 0;
+    subscriber->function(subscriber, &summary);
+#ifdef USE_LOGGER_COLOR
+    if (record != NULL) {
+        record->coloredLine = NULL;     // colored line buffer was reused by summary
+    }
+#else
+    (void) record;
+#endif
+}
+
+static uint64_t hashRecord(const LogRecord *record) {
+    const char *tag = record->tag != NULL ? record->tag : "";
+    uint64_t hash = hashBytes(14695981039346656037u, tag, strlen(tag) + 1);
+    uint8_t severity = (uint8_t) record->severity;
+    hash = hashBytes(hash, &severity, sizeof(severity));
+    if (record->length > 0) {
+        return hashBytes(hash, record->line + record->messageOffset, record->length - record->messageOffset);
+    }
+
+    hash = hashBytes(hash, &record->format, sizeof(record->format));  // not rendered, message is identified by format and captured arguments
+    return hashBytes(hash, record->arguments, record->argumentsLength);
+}
+
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t length) {  // FNV-1a
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+static bool enqueueAsyncMessage(LoggerSite *site, const char *tag, LogLevel severity, const char *format, va_list list) {
+    AsyncMessage *message;
+    size_t position = atomic_load_explicit(&asyncEnqueuePosition, memory_order_relaxed);
+    for (;;) {  // reserve slot, bounded MPMC queue by Dmitry Vyukov
+        message = &asyncQueue[position & asyncQueueMask];
+        size_t sequence = atomic_load_explicit(&message->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&asyncEnqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false;   // queue is full
+        } else {
+            position = atomic_load_explicit(&asyncEnqueuePosition, memory_order_relaxed);
+        }
+    }
+
+    tag = tag != NULL ? tag : "";
+    size_t tagLength = strnlen(tag, LOGGER_BUFFER_SIZE / 4);
+    memcpy(message->text, tag, tagLength);
+    message->text[tagLength] = '\0';
+    message->tagLength = tagLength;
+    message->severity = severity;
+    readRealTime(&message->timestamp);
+
+    char *messageText = message->text + tagLength + 1;
+    size_t messageCapacity = LOGGER_BUFFER_SIZE - tagLength - 1;
+    bool isCaptureNeeded = atomic_load_explicit(&isDeferredFormatting, memory_order_relaxed) || atomic_load_explicit(&hasBinarySubscriber, memory_order_relaxed);
+    message->format = (site != NULL && isCaptureNeeded) ? getSiteFormat(site, format) : NULL;
+    if (message->format != NULL) {     // only copy arguments, formatting is done by backend thread
+        va_list arguments;
+        va_copy(arguments, list);
+        if (!captureArguments(message->format, arguments, (uint8_t *) messageText, messageCapacity, &message->argumentsLength)) {
+            message->format = NULL;
+        }
+        va_end(arguments);
+    }
+
+    if (message->format == NULL) {
+        vsnprintf(messageText, messageCapacity, format, list);
+    }
+    atomic_store_explicit(&message->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+static bool dispatchAsyncMessage() {
+    size_t position = atomic_load_explicit(&asyncDequeuePosition, memory_order_relaxed);
+    AsyncMessage *message = &asyncQueue[position & asyncQueueMask];
+    if (atomic_load_explicit(&message->sequence, memory_order_acquire) != position + 1) {
+        return false;   // empty or not yet published
+    }
+
+    LogRecord record = {.tag = message->text, .severity = message->severity, .timestamp = message->timestamp, .line = lineBuffer};
+    if (loggerIsLevelEnabled(message->severity) && (!atomic_load_explicit(&hasTagFilter, memory_order_relaxed) || isRecordAccepted(&record))) {
+        const char *messageText = message->text + message->tagLength + 1;
+        if (message->format != NULL) {
+            record.format = message->format;
+            record.arguments = (const uint8_t *) messageText;
+            record.argumentsLength = message->argumentsLength;
+        }
+
+        if (isRecordRenderNeeded(&record)) {
+            renderRecordPrefix(&record, atomic_load_explicit(&timestampPrecision, memory_order_relaxed));
+            char *recordMessage = record.line + record.messageOffset;
+            size_t messageCapacity = LOGGER_BUFFER_SIZE - record.messageOffset - 1;
+            if (message->format != NULL) {
+                completeRecord(&record, formatDeferredMessage(recordMessage, messageCapacity, message->format, (const uint8_t *) messageText));
+            } else {
+                size_t messageLength = strnlen(messageText, messageCapacity - 1);
+                memcpy(recordMessage, messageText, messageLength);
+                completeRecord(&record, messageLength);
+            }
+        }
+        dispatchRecord(&record);
+    }
+
+    atomic_store_explicit(&message->sequence, position + asyncQueueMask + 1, memory_order_release);
+    atomic_store_explicit(&asyncDequeuePosition, position + 1, memory_order_release);
+    return true;
+}
+
+static void reportDroppedMessages() {
+    uint32_t droppedCount = atomic_exchange(&asyncDroppedCount, 0);
+    if (droppedCount > 0 && loggerIsLevelEnabled(LOG_LEVEL_WARN)) {
+        LogRecord record = {.tag = "LOGGER", .severity = LOG_LEVEL_WARN, .line = lineBuffer};
+        readRealTime(&record.timestamp);
+        renderMessage(&record, "Asynchronous queue is full, dropped [%u] messages", droppedCount);
+        dispatchRecord(&record);
+    }
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+static DWORD WINAPI asyncWorker(LPVOID argument) {
+#else
+static void *asyncWorker(void *argument) {
+#endif
+    (void) argument;
+    for (;;) {
+        if (dispatchAsyncMessage()) {
+            continue;
+        }
+        reportDroppedMessages();
+        flushFileBuffers(true);     // write out messages left in buffers when queue is idle
+
+        if (!atomic_load(&isAsyncRunning) &&
+            atomic_load(&asyncProducerCount) == 0 &&
+            atomic_load(&asyncEnqueuePosition) == atomic_load(&asyncDequeuePosition)) {
+            break;  // stopped and fully drained
+        }
+        sleepMicroseconds(LOGGER_ASYNC_IDLE_SLEEP_US);
+    }
+    return 0;
+}
+
+static void lockAsyncState() {  // takes configuration lock when no backend thread is being stopped
+    initThreadLock();
+    lockThread();
+    while (isAsyncStopping) {
+        unlockThread();
+        sleepMicroseconds(LOGGER_ASYNC_IDLE_SLEEP_US);
+        lockThread();
+    }
+}
+
+static void sleepMicroseconds(uint32_t microseconds) {
+#if defined(_WIN32) || defined(_WIN64)
+    Sleep(microseconds < 1000 ? 1 : microseconds / 1000);
+#else
+    struct timespec delay = {.tv_sec = microseconds / 1000000, .tv_nsec = (microseconds % 1000000) * 1000L};
+    nanosleep(&delay, NULL);
+#endif
+}
+
+static uint64_t nextRandom() {
+    if (randomState == 0) {
+        struct timespec time;
+        readRealTime(&time);
+        randomState = ((uint64_t) (uintptr_t) &randomState ^ (uint64_t) time.tv_nsec * 0x9E3779B97F4A7C15u) | 1;
+    }
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+
+static void consoleCallback(LoggerEvent *event, LogRecord *record) {
+    (void) event;
+#ifdef USE_LOGGER_COLOR
+    renderColoredRecord(record);
+    fwrite(record->coloredLine, sizeof(char), record->coloredLength, stdout);
+#else
+    fwrite(record->line, sizeof(char), record->length, stdout);
+#endif
+}
+
+static void fileCallback(LoggerEvent *event, LogRecord *record) {
+    if (rotateLogFiles(event)) {
+        fwrite(record->line, sizeof(char), record->length, event->file->out);
+        syncLogFile(event, record->severity, record->length);
+        event->file->size += record->length;
+    }
+}
+
+static void customCallback(LoggerEvent *event, LogRecord *record) {
+    event->callback(record->severity, record->line, record->length);
+}
+
+static void binaryFileCallback(LoggerEvent *event, LogRecord *record) {
+    if (!rotateLogFiles(event)) {
+        return;
+    }
+
+    LogBinaryDictionary *dictionary = event->dictionary;
+    uint64_t startSize = event->file->size;
+    if (event->file->size == 0 || !dictionary->isHeaderWritten) {   // new or rotated file
+        writeBinaryHeader(event, record->timestamp);
+    }
+
+    int64_t timestampDelta = (int64_t) (record->timestamp.tv_sec - dictionary->lastTimestamp.tv_sec) * 1000000000 +
+                             (record->timestamp.tv_nsec - dictionary->lastTimestamp.tv_nsec);
+    if (timestampDelta < 0 || timestampDelta > UINT32_MAX) {  // clock moved back or long pause between messages
+        writeBinaryTime(event, record->timestamp);
+        timestampDelta = 0;
+    }
+    dictionary->lastTimestamp = record->timestamp;
+
+    LogBinaryRecordHeader header = {
+            .type = LOG_BINARY_RECORD,
+            .severity = record->severity,
+            .tagId = writeBinaryTag(event, record->tag),
+            .timestampDelta = (uint32_t) timestampDelta
+    };
+    const void *payload;
+    if (record->format != NULL && record->format->id != 0) {
+        writeBinaryFormat(event, record->format);
+        header.formatId = record->format->id;
+        header.length = record->argumentsLength;
+        payload = record->arguments;
+    } else {    // message without parsed format is stored as plain text without line terminator
+        header.length = (uint16_t) (record->length - record->messageOffset - 1);
+        payload = record->line + record->messageOffset;
+    }
+
+    writeBinaryData(event, &header.type, sizeof(header.type));
+    writeBinaryData(event, &header.severity, sizeof(header.severity));
+    writeBinaryData(event, &header.tagId, sizeof(header.tagId));
+    writeBinaryData(event, &header.formatId, sizeof(header.formatId));
+    writeBinaryData(event, &header.length, sizeof(header.length));
+    writeBinaryData(event, &header.timestampDelta, sizeof(header.timestampDelta));
+    writeBinaryData(event, payload, header.length);
+    syncLogFile(event, record->severity, event->file->size - startSize);
+}
+
+static void initThreadLock() {
+    if (isLockInitialized) return;
+#if defined(_WIN32) || defined(_WIN64)
+    InitializeCriticalSection(&threadMutex);
+#else
+    pthread_mutex_init(&threadMutex, NULL);
+#endif
+    isLockInitialized = true;
+}
+
+static void lockThread() {
+#if defined(_WIN32) || defined(_WIN64)
+    EnterCriticalSection(&threadMutex);
+#else
+    pthread_mutex_lock(&threadMutex);
+#endif /* defined(_WIN32) || defined(_WIN64) */
+}
+
+static void unlockThread() {
+#if defined(_WIN32) || defined(_WIN64)
+    LeaveCriticalSection(&threadMutex);
+#else
+    pthread_mutex_unlock(&threadMutex);
+#endif /* defined(_WIN32) || defined(_WIN64) */
+}
+
+static void initSubscriberLock(LoggerEvent *subscriber) {
+#if defined(_WIN32) || defined(_WIN64)
+    InitializeCriticalSection(&subscriber->mutex);
+#else
+    pthread_mutex_init(&subscriber->mutex, NULL);
+#endif
+}
+
+static void destroySubscriberLock(LoggerEvent *subscriber) {
+#if defined(_WIN32) || defined(_WIN64)
+    DeleteCriticalSection(&subscriber->mutex);
+#else
+    pthread_mutex_destroy(&subscriber->mutex);
+#endif
+}
+
+static void lockSubscriber(LoggerEvent *subscriber) {
+#if defined(_WIN32) || defined(_WIN64)
+    EnterCriticalSection(&subscriber->mutex);
+#else
+    pthread_mutex_lock(&subscriber->mutex);
+#endif /* defined(_WIN32) || defined(_WIN64) */
+}
+
+static void unlockSubscriber(LoggerEvent *subscriber) {
+#if defined(_WIN32) || defined(_WIN64)
+    LeaveCriticalSection(&subscriber->mutex);
+#else
+    pthread_mutex_unlock(&subscriber->mutex);
+#endif /* defined(_WIN32) || defined(_WIN64) */
+}
+
+static LogTagEntry *getTagEntry(const char *tag) {
+    if (tag == NULL) {
+        return NULL;
+    }
+
+    uint32_t hash = hashTag(tag);
+    LogTagEntry *entry = findTagEntry(tag, hash);
+    if (entry != NULL) {
+        return entry;
+    }
+
+    initThreadLock();
+    lockThread();
+    uint32_t index = hash % LOGGER_MAX_TAGS;
+    for (uint32_t i = 0; i < LOGGER_MAX_TAGS; i++) {
+        entry = &tagTable[(index + i) % LOGGER_MAX_TAGS];
+        const char *name = atomic_load_explicit(&entry->name, memory_order_relaxed);
+        if (name == NULL) {
+            size_t length = strlen(tag) + 1;
+            char *entryName = malloc(length);
+            if (entryName == NULL) {
+                break;
+            }
+            memcpy(entryName, tag, length);
+            entry->hash = hash;
+            atomic_store_explicit(&entry->level, resolveTagLevel(tag), memory_order_relaxed);
+            atomic_store_explicit(&entry->name, entryName, memory_order_release);    // publish initialized entry
+            unlockThread();
+            return entry;
+        }
+
+        if (entry->hash == hash && strcmp(name, tag) == 0) {   // inserted by other thread
+            unlockThread();
+            return entry;
+        }
+    }
+    unlockThread();
+    return NULL;
+}
+
+static LogTagEntry *findTagEntry(const char *tag, uint32_t hash) {
+    uint32_t index = hash % LOGGER_MAX_TAGS;
+    for (uint32_t i = 0; i < LOGGER_MAX_TAGS; i++) {
+        LogTagEntry *entry = &tagTable[(index + i) % LOGGER_MAX_TAGS];
+        const char *name = atomic_load_explicit(&entry->name, memory_order_acquire);
+        if (name == NULL) {
+            return NULL;
+        }
+
+        if (entry->hash == hash && strcmp(name, tag) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static LogTagRule *findTagRule(const char *tag, bool isCreate) {
+    LogTagRule *rule = &tagRuleRoot;
+    const char *segment = tag;
+    for (;;) {
+        const char *segmentEnd = strchr(segment, '.');
+        size_t length = (segmentEnd != NULL) ? (size_t) (segmentEnd - segment) : strlen(segment);
+        LogTagRule *child = findTagRuleChild(rule, segment, length);
+
+        if (child == NULL) {
+            if (!isCreate) {
+                return NULL;
+            }
+            child = calloc(1, sizeof(struct LogTagRule));
+            char *childSegment = malloc(length + 1);
+            if (child == NULL || childSegment == NULL) {
+                free(child);
+                free(childSegment);
+                return NULL;
+            }
+            memcpy(childSegment, segment, length);
+            childSegment[length] = '\0';
+            child->segment = childSegment;
+            child->length = length;
+            child->level = -1;
+            child->next = rule->children;
+            rule->children = child;
+        }
+
+        rule = child;
+        if (segmentEnd == NULL) {
+            return rule;
+        }
+        segment = segmentEnd + 1;
+    }
+}
+
+static LogTagRule *findTagRuleChild(const LogTagRule *rule, const char *segment, size_t length) {
+    LogTagRule *child = rule->children;
+    while (child != NULL && (child->length != length || memcmp(child->segment, segment, length) != 0)) {
+        child = child->next;
+    }
+    return child;
+}
+
+static int8_t resolveTagLevel(const char *tag) {    // the most specific rule wins: "net.http" over "net" for "net.http.client"
+    int8_t level = atomic_load(&defaultTagLevel);
+    const LogTagRule *rule = &tagRuleRoot;
+    const char *segment = tag;
+    for (;;) {
+        const char *segmentEnd = strchr(segment, '.');
+        size_t length = (segmentEnd != NULL) ? (size_t) (segmentEnd - segment) : strlen(segment);
+        const LogTagRule *child = findTagRuleChild(rule, segment, length);
+
+        if (child == NULL) {
+            return level;
+        }
+
+        if (child->level >= 0) {
+            level = child->level;
+        }
+        if (segmentEnd == NULL) {
+            return level;
+        }
+        rule = child;
+        segment = segmentEnd + 1;
+    }
+}
+
+static int getMinTagRuleLevel(const LogTagRule *rule, int level) {
+    for (const LogTagRule *child = rule->children; child != NULL; child = child->next) {
+        if (child->level >= 0 && child->level < level) {
+            level = child->level;
+        }
+        level = getMinTagRuleLevel(child, level);
+    }
+    return level;
+}
+
+static void updateTagLevels() {     // effective level is resolved once per tag when rules change, not per message
+    for (uint32_t i = 0; i < LOGGER_MAX_TAGS; i++) {
+        LogTagEntry *entry = &tagTable[i];
+        const char *name = atomic_load(&entry->name);
+        if (name != NULL) {
+            atomic_store(&entry->level, resolveTagLevel(name));
+        }
+    }
+    updateDispatchState();
+}
+
+static void updateDispatchState() {
+    int threshold = NO_SUBSCRIBERS_LEVEL;
+    bool isConsoleSubscribed = false;
+    bool isBinarySubscribed = false;
+    bool isTextSubscribed = false;
+    bool isTagFiltered = false;
+    const LoggerSnapshot *snapshot = atomic_load(&currentSnapshot);   // configuration lock is held, snapshot can't change
+    for (uint32_t i = 0; i < snapshot->count; i++) {
+        LoggerEvent *subscriber = snapshot->subscribers[i];
+        if ((int) subscriber->level < threshold) {
+            threshold = subscriber->level;
+        }
+        isConsoleSubscribed |= subscriber->function == consoleCallback;
+        isBinarySubscribed |= subscriber->function == binaryFileCallback;
+        isTextSubscribed |= subscriber->function != binaryFileCallback;
+        isTagFiltered |= atomic_load(&subscriber->allowedTags) != NULL || atomic_load(&subscriber->deniedTags) != NULL;
+    }
+
+    int tagThreshold = getMinTagRuleLevel(&tagRuleRoot, atomic_load(&defaultTagLevel));   // messages of any tag are rejected below this level
+    if (tagThreshold > threshold) {
+        threshold = tagThreshold;
+    }
+    atomic_store(&loggerThresholdLevel, threshold);
+    atomic_store(&hasBinarySubscriber, isBinarySubscribed);
+    atomic_store(&hasTextSubscriber, isTextSubscribed);
+    atomic_store(&hasTagFilter, isTagFiltered);
+#ifdef USE_LOGGER_COLOR
+    atomic_store(&hasConsoleSubscriber, isConsoleSubscribed);
+#else
+    (void) isConsoleSubscribed;
+#endif
+}
+
+static void setTagFilter(LoggerEvent *subscriber, _Atomic(LogTagFilter *) *filter, const char *const tags[], uint32_t count) {
+    LogTagFilter *tagFilter = NULL;
+    if (tags != NULL && count > 0) {
+        tagFilter = createTagFilter(tags, count);
+        if (tagFilter == NULL) {
+            fprintf(stderr, "ERROR: Memory allocation fail, tag filter of subscriber is not changed\n");
+            return;
+        }
+    }
+
+    LogTagFilter *previousFilter = atomic_exchange(filter, tagFilter);
+    if (subscriber->isSubscribed) {
+        updateDispatchState();
+        waitForSnapshotReaders();   // previous filter can be released only when no thread is checking it
+    }
+    free(previousFilter);
+}
+
+static LogTagFilter *createTagFilter(const char *const tags[], uint32_t count) {
+    size_t namesSize = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        namesSize += strlen(tags[i] != NULL ? tags[i] : "") + 1;
+    }
+
+    LogTagFilter *filter = malloc(sizeof(LogTagFilter) + count * sizeof(LogTagFilterEntry) + namesSize);
+    if (filter == NULL) {
+        return NULL;
+    }
+
+    char *names = (char *) &filter->entries[count];
+    filter->mask = 0;
+    filter->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        const char *tag = tags[i] != NULL ? tags[i] : "";
+        size_t length = strlen(tag) + 1;
+        memcpy(names, tag, length);
+        filter->entries[i].name = names;
+        filter->entries[i].hash = hashTag(tag);
+        filter->mask |= getTagFilterBits(filter->entries[i].hash);
+        names += length;
+    }
+    return filter;
+}
+
+static bool isTagInFilter(const LogTagFilter *filter, const char *tag, uint32_t hash) {
+    uint64_t bits = getTagFilterBits(hash);
+    if ((filter->mask & bits) != bits) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < filter->count; i++) {
+        if (filter->entries[i].hash == hash && strcmp(filter->entries[i].name, tag) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t getTagFilterBits(uint32_t hash) {
+    return (UINT64_C(1) << (hash & 63)) | (UINT64_C(1) << ((hash >> 6) & 63));
+}
+
+static uint64_t getLogFileSize(const char *fileName) {
+    FILE *logFile;
+    if ((logFile = fopen(fileName, "rb")) == NULL) {
+        return 0;
+    }
+    fseek(logFile, 0, SEEK_END);
+    long fileSize = ftell(logFile);
+    fclose(logFile);
+    return fileSize > 0 ? fileSize : 0;
+}
+
+static void syncLogFile(LoggerEvent *event, LogLevel severity, size_t length) {
+    LogFileSyncPolicy *policy = &event->syncPolicy;
+    event->unsyncedBytes += length;
+    event->bufferedBytes += length;
+
+    bool isSyncNeeded = policy->mode == LOG_FILE_SYNC_ALWAYS || (policy->level != LOG_LEVEL_UNKNOWN && severity >= policy->level);
+    if (!isSyncNeeded && policy->mode == LOG_FILE_SYNC_PERIODIC) {
+        isSyncNeeded = (policy->bytes > 0 && event->unsyncedBytes >= policy->bytes) ||
+                       (policy->intervalMs > 0 && getMonotonicTimeMs() - event->lastSyncTime >= policy->intervalMs);
+    }
+
+    if (!isSyncNeeded) {
+        if (policy->mode == LOG_FILE_SYNC_FLUSH ||
+            (event->flushIntervalMs > 0 && getMonotonicTimeMs() - event->lastFlushTime >= event->flushIntervalMs)) {
+            flushLogFile(event);
+        }
+        return;
+    }
+
+    flushLogFile(event);
+#if !defined(_WIN32) && !defined(_WIN64)
+    #if defined(__APPLE__)
+    fsync(fileno(event->file->out));
+    #else
+    if (policy->isDataOnly) {
+        fdatasync(fileno(event->file->out));
+    } else {
+        fsync(fileno(event->file->out));
+    }
+    #endif
+#endif /* defined(_WIN32) || defined(_WIN64) */
+    event->unsyncedBytes = 0;
+    if (policy->mode == LOG_FILE_SYNC_PERIODIC && policy->intervalMs > 0) {
+        event->lastSyncTime = getMonotonicTimeMs();
+    }
+}
+
+static void flushLogFile(LoggerEvent *event) {
+    fflush(event->file->out);
+    event->bufferedBytes = 0;
+    if (event->flushIntervalMs > 0) {
+        event->lastFlushTime = getMonotonicTimeMs();
+    }
+}
+
+static void flushFileBuffers(bool isOnlyExpired) {
+    uint64_t now = getMonotonicTimeMs();    // also the start of the next deduplication window
+    unsigned int parity;
+    const LoggerSnapshot *snapshot = acquireSnapshot(&parity);
+    for (uint32_t i = 0; i < snapshot->count; i++) {
+        LoggerEvent *subscriber = snapshot->subscribers[i];
+        lockSubscriber(subscriber);
+        LogDeduplicator *deduplicator = subscriber->deduplicator;
+        if (deduplicator != NULL && deduplicator->repeatCount > 0 &&
+            (!isOnlyExpired || now - deduplicator->streakStartTime >= deduplicator->windowMs)) {
+            writeRepeatSummary(subscriber, NULL);
+            deduplicator->streakStartTime = now;
+        }
+
+        if (subscriber->file != NULL && subscriber->file->out != NULL && subscriber->bufferedBytes > 0 &&
+            (!isOnlyExpired || (subscriber->flushIntervalMs > 0 && now - subscriber->lastFlushTime >= subscriber->flushIntervalMs))) {
+            flushLogFile(subscriber);
+        }
+        unlockSubscriber(subscriber);
+    }
+    releaseSnapshot(parity);
+}
+
+static uint64_t getMonotonicTimeMs() {
+#if defined(_WIN32) || defined(_WIN64)
+    return GetTickCount64();
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000 + time.tv_nsec / 1000000;
+#endif /* defined(_WIN32) || defined(_WIN64) */
+}
+
+static bool rotateLogFiles(LoggerEvent *event) {
+    bool isPeriodEnded = event->rotationDeadline != 0 && getMonotonicTimeMs() >= event->rotationDeadline;
+    if (event->file->size <= event->file->maxSize && (!isPeriodEnded || event->file->size == 0)) {
+        if (isPeriodEnded) {
+            updateRotationDeadline(event);  // empty file is kept for the next period
+        }
+        return event->file->out != NULL;
+    }
+
+    if (event->maxBackupFiles == 0) {
+        fprintf(stderr, "ERROR: Log file is full: [%s]\n", event->file->name);
+        return false;
+    }
+
+    if (event->isBackgroundRotation) {
+        LogRotationJob *job = createRotationJob(event);
+        if (job == NULL) {
+            fprintf(stderr, "ERROR: Memory allocation fail, log file is not rotated: [%s]\n", event->file->name);
+            return event->file->out != NULL;
+        }
+        updateRotationDeadline(event);
+        return switchLogFile(event, job);
+    }
+
+    if (event->file->out != NULL) {
+        fclose(event->file->out);
+        event->file->out = NULL;
+    }
+    bool isArchived = archiveLogFile(event, event->file->name, event->file->size, getBackupTimestamp(event));
+    updateRotationDeadline(event);
+    return openLogFile(event, isArchived);
+}
+
+static time_t getBackupTimestamp(const LoggerEvent *event) {   // time based rotation names backup by the time it was started
+    return event->rotationPeriod != LOG_ROTATION_NONE ? event->fileStartTime : time(NULL);
+}
+
+static void updateRotationDeadline(LoggerEvent *event) {   // called once per file, so log call only compares monotonic time
+    struct timespec now;
+    readRealTime(&now);
+    uint64_t nowMs = getMonotonicTimeMs();
+    event->fileStartTime = now.tv_sec;
+    if (event->rotationPeriod == LOG_ROTATION_NONE || (event->rotationPeriod == LOG_ROTATION_INTERVAL && event->rotationIntervalMs == 0)) {
+        event->rotationDeadline = 0;
+        return;
+    }
+
+    if (event->rotationPeriod == LOG_ROTATION_INTERVAL) {
+        event->rotationDeadline = nowMs + event->rotationIntervalMs;
+        return;
+    }
+
+    struct tm boundary;
+    if (convertToLocalTime(now.tv_sec, &boundary) == NULL) {
+        event->rotationDeadline = 0;
+        return;
+    }
+    boundary.tm_min = 0;
+    boundary.tm_sec = 0;
+    boundary.tm_isdst = -1;     // next boundary can be in other daylight saving time
+    if (event->rotationPeriod == LOG_ROTATION_HOURLY) {
+        boundary.tm_hour++;
+    } else {
+        boundary.tm_hour = 0;
+        boundary.tm_mday++;
+    }
+
+    time_t boundaryTime = mktime(&boundary);
+    int64_t remainingMs = (int64_t) (boundaryTime - now.tv_sec) * 1000 - now.tv_nsec / 1000000;
+    event->rotationDeadline = nowMs + (remainingMs > 0 ? (uint64_t) remainingMs : 1);
+}
+
+static bool openLogFile(LoggerEvent *event, bool isMovedAway) {   // standby can take the name only when active file is moved away
+    if (isMovedAway && event->standbyOut != NULL) {
+        if (rename(event->standbyName, event->file->name) == 0) {
+            event->file->out = event->standbyOut;
+        } else {
+            fprintf(stderr, "ERROR: Failed to rename log file. From [%s] to [%s]\n", event->standbyName, event->file->name);
+            fclose(event->standbyOut);
+        }
+        event->standbyOut = NULL;
+    }
+
+    if (event->file->out == NULL) {
+        event->file->out = fopen(event->file->name, "a"); // create empty file with original log file name
+    }
+    if (event->file->out == NULL) {
+        fprintf(stderr, "ERROR: Failed to open log file: [%s]\n", event->file->name);
+        return false;
+    }
+
+    if (event->writeBuffer != NULL) {   // standby file is not written yet, so buffer still can be set
+        setvbuf(event->file->out, event->writeBuffer, _IOFBF, event->writeBufferSize);
+    }
+    event->bufferedBytes = 0;
+    event->file->size = isMovedAway ? 0 : getLogFileSize(event->file->name);
+    return true;
+}
+
+static FILE *createStandbyFile(LoggerEvent *event) {   // truncates standby file left by previous run
+    FILE *file = fopen(event->standbyName, "w");
+    if (file == NULL) {
+        fprintf(stderr, "ERROR: Failed to create standby log file: [%s]\n", event->standbyName);
+        return NULL;
+    }
+#if defined(__linux__)
+    if (event->isStandbyPreallocated) {
+        fallocate(fileno(file), FALLOC_FL_KEEP_SIZE, 0, event->file->maxSize);    // reserve disk space, file size stays 0
+    }
+#endif
+    return file;
+}
+
+static bool archiveLogFile(LoggerEvent *event, const char *fileName, uint64_t size, time_t timestamp) {  // moves closed file to the newest backup
+    LogFile backupFile = event->backupFiles[0];  // first is the empty or oldest backup file
+    if (backupFile.name[0] != '\0') {   // remove already existing file
+        if (remove(backupFile.name) != 0) {
+            fprintf(stderr, "ERROR: Failed to remove backup log file: [%s]\n", backupFile.name);
+        }
+        event->backupSize -= backupFile.size;
+    }
+
+    size_t length = strlen(event->file->name) + FILE_TIMESTAMP_LENGTH;
+    formatBackupFileName(event->file->name, backupFile.name, length, timestamp, event->rotationPeriod == LOG_ROTATION_HOURLY);
+    size_t nameLength = strlen(backupFile.name);
+    for (uint32_t id = 2; id <= BACKUP_NAME_MAX_ID && isBackupNameTaken(event, backupFile.name); id++) {
+        sprintf(backupFile.name + nameLength, ".%u", id);  // file with same timestamp already exist, so add unique id
+    }
+
+    bool isRenamed = rename(fileName, backupFile.name) == 0;
+    if (!isRenamed) {
+        fprintf(stderr, "ERROR: Failed to rename log file. From [%s] to [%s]\n", fileName, backupFile.name);
+    }
+    backupFile.size = isRenamed ? size : 0;
+    backupFile.maxSize = event->file->maxSize;
+    backupFile.closeTime = time(NULL);
+    event->backupSize += backupFile.size;
+
+    shiftBackupFilesLeft(event->backupFiles, event->maxBackupFiles);    // move backups
+    event->backupFiles[event->maxBackupFiles - 1] = backupFile;  // put the newest backup file to the end of array
+    removeExpiredBackupFiles(event);
+    return isRenamed;
+}
+
+static void removeExpiredBackupFiles(LoggerEvent *event) {  // backups are ordered from the oldest, so removing stops at the first kept one
+    time_t now = time(NULL);
+    for (uint8_t i = 0; i < event->maxBackupFiles; i++) {
+        LogFile *backupFile = &event->backupFiles[i];
+        if (backupFile->name[0] == '\0') {
+            continue;
+        }
+
+        // active file is counted with its maximum size, so total size stays in limit while it grows
+        bool isOverTotalSize = event->maxTotalSize > 0 && event->backupSize + event->file->maxSize > event->maxTotalSize;
+        bool isExpired = event->maxBackupAgeSec > 0 && now - backupFile->closeTime > (time_t) event->maxBackupAgeSec;
+        if (!isOverTotalSize && !isExpired) {
+            return;
+        }
+
+        if (remove(backupFile->name) != 0) {
+            fprintf(stderr, "ERROR: Failed to remove backup log file: [%s]\n", backupFile->name);
+        }
+        event->backupSize -= backupFile->size;
+        backupFile->name[0] = '\0';    // slot stays at the start, so it's reused by the next rotation
+        backupFile->size = 0;
+    }
+}
+
+static LogRotationJob *createRotationJob(LoggerEvent *event) {
+    size_t nameLength = strlen(event->file->name) + ROTATED_NAME_SUFFIX_LENGTH;
+    LogRotationJob *job = malloc(sizeof(LogRotationJob) + nameLength);
+    if (job == NULL) {
+        return NULL;
+    }
+
+    job->writeBuffer = NULL;
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (event->writeBuffer != NULL) {   // rotated file keeps its buffer until it's closed, so new file gets another one
+        char *writeBuffer = event->spareWriteBuffer != NULL ? event->spareWriteBuffer : malloc(event->writeBufferSize);
+        if (writeBuffer == NULL) {
+            free(job);
+            return NULL;
+        }
+        job->writeBuffer = event->writeBuffer;
+        event->writeBuffer = writeBuffer;
+        event->spareWriteBuffer = NULL;
+    }
+#endif
+    job->subscriber = event;
+    job->size = event->file->size;
+    job->timestamp = getBackupTimestamp(event);
+    snprintf(job->name, nameLength, "%s.%u.rotated", event->file->name, event->rotationCount++);
+    return job;
+}
+
+static bool switchLogFile(LoggerEvent *event, LogRotationJob *job) {   // called by log call, the rest of rotation is done by rotation thread
+#if defined(_WIN32) || defined(_WIN64)
+    if (event->file->out != NULL) {
+        fclose(event->file->out);   // open file can't be renamed
+    }
+    job->out = NULL;
+#else
+    job->out = event->file->out;    // closed by rotation thread, renamed file keeps receiving buffered messages
+#endif
+    event->file->out = NULL;
+
+    bool isRenamed = rename(event->file->name, job->name) == 0;
+    if (!isRenamed) {
+        fprintf(stderr, "ERROR: Failed to rename log file. From [%s] to [%s]\n", event->file->name, job->name);
+        job->name[0] = '\0';
+    }
+
+    atomic_fetch_add(&pendingRotationCount, 1);
+    job->next = atomic_load(&rotationJobs);
+    while (!atomic_compare_exchange_weak(&rotationJobs, &job->next, job));
+    return openLogFile(event, isRenamed);
+}
+
+static void processRotationJobs(LogRotationJob *jobs) {
+    LogRotationJob *job = NULL;
+    while (jobs != NULL) {  // stack holds the newest job first, restore rotation order
+        LogRotationJob *next = jobs->next;
+        jobs->next = job;
+        job = jobs;
+        jobs = next;
+    }
+
+    while (job != NULL) {
+        LoggerEvent *event = job->subscriber;
+        if (job->out != NULL) {
+            fclose(job->out);
+        }
+
+        if (job->writeBuffer != NULL) {
+            lockSubscriber(event);
+            if (event->spareWriteBuffer == NULL) {
+                event->spareWriteBuffer = job->writeBuffer;
+                job->writeBuffer = NULL;
+            }
+            unlockSubscriber(event);
+            free(job->writeBuffer);
+        }
+
+        if (job->name[0] != '\0') {
+            archiveLogFile(event, job->name, job->size, job->timestamp);    // backups of this subscriber are changed only by rotation thread
+        }
+
+        lockSubscriber(event);
+        bool isStandbyNeeded = event->isStandbyFile && event->standbyOut == NULL;
+        unlockSubscriber(event);
+        if (isStandbyNeeded) {  // created without lock, log call can't use missing standby meanwhile
+            FILE *standbyOut = createStandbyFile(event);
+            lockSubscriber(event);
+            event->standbyOut = standbyOut;
+            unlockSubscriber(event);
+        }
+
+        LogRotationJob *next = job->next;
+        free(job);
+        atomic_fetch_sub(&pendingRotationCount, 1);
+        job = next;
+    }
+}
+
+static bool startRotationWorker() {     // called with configuration lock
+    if (rotationSubscriberCount++ > 0) {
+        return true;
+    }
+
+    atomic_store(&isRotationRunning, true);
+#if defined(_WIN32) || defined(_WIN64)
+    rotationThread = CreateThread(NULL, 0, rotationWorker, NULL, 0, NULL);
+    bool isThreadStarted = rotationThread != NULL;
+#else
+    bool isThreadStarted = pthread_create(&rotationThread, NULL, rotationWorker, NULL) == 0;
+#endif
+    if (!isThreadStarted) {
+        fprintf(stderr, "ERROR: Failed to start log rotation thread\n");
+        atomic_store(&isRotationRunning, false);
+        rotationSubscriberCount--;
+        return false;
+    }
+    return true;
+}
+
+static void stopRotationWorker() {     // called with configuration lock
+    if (--rotationSubscriberCount > 0) {
+        return;
+    }
+
+    atomic_store(&isRotationRunning, false);
+#if defined(_WIN32) || defined(_WIN64)
+    WaitForSingleObject(rotationThread, INFINITE);
+    CloseHandle(rotationThread);
+#else
+    pthread_join(rotationThread, NULL);
+#endif
+}
+
+static void waitForRotationJobs() {
+    while (atomic_load(&pendingRotationCount) != 0) {
+        sleepMicroseconds(SNAPSHOT_WAIT_SLEEP_US);
+    }
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+static DWORD WINAPI rotationWorker(LPVOID argument) {
+#else
+static void *rotationWorker(void *argument) {
+#endif
+    (void) argument;
+    while (atomic_load(&isRotationRunning) || atomic_load(&rotationJobs) != NULL) {
+        LogRotationJob *jobs = atomic_exchange(&rotationJobs, NULL);
+        if (jobs != NULL) {
+            processRotationJobs(jobs);
+        } else {
+            sleepMicroseconds(ROTATION_IDLE_SLEEP_US);
+        }
+    }
+    return 0;
+}
+
+static void loadBackupFiles(LoggerEvent *event) {  // single directory pass, backups of previous runs are rotated as own ones
+    if (event->maxBackupFiles == 0) {
+        return;
+    }
+
+    const char *fileName = event->file->name;
+    const char *baseName = fileName;
+    for (const char *position = fileName; *position != '\0'; position++) {
+        if (*position == '/' || *position == '\\') {
+            baseName = position + 1;
+        }
+    }
+    size_t directoryLength = baseName - fileName;
+    size_t baseNameLength = strstr(baseName, ".log") - baseName;
+    char directory[LOGGER_FILE_NAME_MAX_SIZE + 2];
+    snprintf(directory, sizeof(directory), "%.*s", (int) directoryLength, fileName);
+
+    size_t maxNameLength = strlen(fileName) + 1 + FILE_TIMESTAMP_LENGTH;   // same as allocated backup names
+    LogBackupCandidate *candidates = NULL;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    char pattern[LOGGER_FILE_NAME_MAX_SIZE + 8];
+    snprintf(pattern, sizeof(pattern), "%s%.*s*", directory, (int) baseNameLength, baseName);
+    WIN32_FIND_DATAA entry;
+    HANDLE search = FindFirstFileA(pattern, &entry);
+    if (search == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    do {
+        bool isRotated = isRotatedFileName(entry.cFileName, baseName);
+        if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && (isRotated || isBackupFileName(entry.cFileName, baseName, baseNameLength))) {
+            uint64_t modifiedTime = ((uint64_t) entry.ftLastWriteTime.dwHighDateTime << 32) | entry.ftLastWriteTime.dwLowDateTime;
+            time_t closeTime = (time_t) ((modifiedTime - 116444736000000000ULL) / 10000000);  // from 1601 to 1970 epoch
+            uint64_t size = ((uint64_t) entry.nFileSizeHigh << 32) | entry.nFileSizeLow;
+            if (!addBackupCandidate(&candidates, &count, &capacity, maxNameLength, directory, directoryLength, entry.cFileName, modifiedTime, closeTime, size, isRotated)) {
+                break;
+            }
+        }
+    } while (FindNextFileA(search, &entry));
+    FindClose(search);
+#else
+    DIR *dir = opendir(directoryLength > 0 ? directory : ".");
+    if (dir == NULL) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        bool isRotated = isRotatedFileName(entry->d_name, baseName);
+        if (!isRotated && !isBackupFileName(entry->d_name, baseName, baseNameLength)) {
+            continue;
+        }
+
+        char path[LOGGER_FILE_NAME_MAX_SIZE + FILE_TIMESTAMP_LENGTH];
+        struct stat status;
+        if (snprintf(path, sizeof(path), "%s%s", directory, entry->d_name) >= (int) sizeof(path) ||
+            stat(path, &status) != 0 || !S_ISREG(status.st_mode)) {
+            continue;
+        }
+    #if defined(__APPLE__)
+        uint64_t modifiedTime = (uint64_t) status.st_mtimespec.tv_sec * 1000000000 + status.st_mtimespec.tv_nsec;
+    #else
+        uint64_t modifiedTime = (uint64_t) status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+    #endif
+        if (!addBackupCandidate(&candidates, &count, &capacity, maxNameLength, directory, directoryLength, entry->d_name, modifiedTime, status.st_mtime, status.st_size, isRotated)) {
+            break;
+        }
+    }
+    closedir(dir);
+#endif
+
+    for (uint32_t i = 0; i < count; i++) {  // renamed after directory pass, so new names are not listed
+        if (candidates[i].isRotated && !archiveRotatedFile(event, &candidates[i], maxNameLength)) {
+            if (remove(candidates[i].name) != 0) {
+                fprintf(stderr, "ERROR: Failed to remove rotated log file: [%s]\n", candidates[i].name);
+            }
+            free(candidates[i].name);
+            candidates[i--] = candidates[--count];
+        }
+    }
+
+    qsort(candidates, count, sizeof(LogBackupCandidate), compareBackupCandidates);
+    uint32_t keptCount = count < event->maxBackupFiles ? count : event->maxBackupFiles;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i < count - keptCount) {    // the oldest ones exceed maxBackupFiles
+            if (remove(candidates[i].name) != 0) {
+                fprintf(stderr, "ERROR: Failed to remove backup log file: [%s]\n", candidates[i].name);
+            }
+        } else {    // the newest backup is the last one, as after rotation
+            LogFile *backupFile = &event->backupFiles[event->maxBackupFiles - count + i];
+            strcpy(backupFile->name, candidates[i].name);
+            backupFile->size = candidates[i].size;
+            backupFile->maxSize = event->file->maxSize;
+            backupFile->closeTime = candidates[i].closeTime;
+            event->backupSize += candidates[i].size;
+        }
+        free(candidates[i].name);
+    }
+    free(candidates);
+    removeExpiredBackupFiles(event);
+}
+
+static bool addBackupCandidate(LogBackupCandidate **candidates, uint32_t *count, uint32_t *capacity, size_t maxNameLength, const char *directory,
+                               size_t directoryLength, const char *name, uint64_t modifiedTime, time_t closeTime, uint64_t size, bool isRotated) {
+    size_t nameLength = directoryLength + strlen(name) + 1;
+    if (nameLength > maxNameLength) {
+        return true;    // doesn't fit into backup name, so it can't be one of ours
+    }
+
+    if (*count == *capacity) {
+        uint32_t newCapacity = *capacity > 0 ? *capacity * 2 : 16;
+        LogBackupCandidate *newCandidates = realloc(*candidates, newCapacity * sizeof(LogBackupCandidate));
+        if (newCandidates == NULL) {
+            fprintf(stderr, "ERROR: Memory allocation fail while loading backup files of: [%s]\n", name);
+            return false;
+        }
+        *candidates = newCandidates;
+        *capacity = newCapacity;
+    }
+
+    LogBackupCandidate *candidate = &(*candidates)[*count];
+    candidate->name = malloc(nameLength);
+    if (candidate->name == NULL) {
+        fprintf(stderr, "ERROR: Memory allocation fail while loading backup files of: [%s]\n", name);
+        return false;
+    }
+    snprintf(candidate->name, nameLength, "%s%s", directory, name);
+    candidate->modifiedTime = modifiedTime;
+    candidate->closeTime = closeTime;
+    candidate->size = size;
+    candidate->isRotated = isRotated;
+    (*count)++;
+    return true;
+}
+
+static bool archiveRotatedFile(LoggerEvent *event, LogBackupCandidate *candidate, size_t maxNameLength) {  // named by the last write time
+    char *backupName = malloc(maxNameLength);
+    if (backupName == NULL) {
+        return false;
+    }
+
+    formatBackupFileName(event->file->name, backupName, maxNameLength - 1, candidate->closeTime, event->rotationPeriod == LOG_ROTATION_HOURLY);
+    size_t nameLength = strlen(backupName);
+    for (uint32_t id = 2; id <= BACKUP_NAME_MAX_ID && isLogFileExist(backupName); id++) {
+        sprintf(backupName + nameLength, ".%u", id);
+    }
+
+    if (rename(candidate->name, backupName) != 0) {
+        fprintf(stderr, "ERROR: Failed to rename log file. From [%s] to [%s]\n", candidate->name, backupName);
+        free(backupName);
+        return false;
+    }
+    free(candidate->name);
+    candidate->name = backupName;
+    return true;
+}
+
+static bool isRotatedFileName(const char *name, const char *fileBaseName) {  // "name.log.<id>.rotated"
+    size_t fileBaseNameLength = strlen(fileBaseName);
+    if (strncmp(name, fileBaseName, fileBaseNameLength) != 0 || name[fileBaseNameLength] != '.') {
+        return false;
+    }
+
+    const char *position = name + fileBaseNameLength + 1;
+    if (!isdigit((unsigned char) *position)) {
+        return false;
+    }
+    while (isdigit((unsigned char) *position)) {
+        position++;
+    }
+    return strcmp(position, ".rotated") == 0;
+}
+
+static bool isBackupFileName(const char *name, const char *baseName, size_t baseNameLength) {  // "name_yyyy-MM-dd[_HH].log[.id]"
+    if (strncmp(name, baseName, baseNameLength) != 0) {
+        return false;
+    }
+
+    const char *position = name + baseNameLength;
+    if (*position++ != '_' || !skipDigits(&position, 4) || *position++ != '-' || !skipDigits(&position, 2) ||
+        *position++ != '-' || !skipDigits(&position, 2)) {
+        return false;
+    }
+
+    if (*position == '_') {
+        position++;
+        if (!skipDigits(&position, 2)) {
+            return false;
+        }
+    }
+
+    if (strncmp(position, ".log", 4) != 0) {
+        return false;
+    }
+    position += 4;
+    if (*position == '.') {
+        position++;
+        if (!isdigit((unsigned char) *position)) {
+            return false;
+        }
+        while (isdigit((unsigned char) *position)) {
+            position++;
+        }
+    }
+    return *position == '\0';
+}
+
+static bool skipDigits(const char **position, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (!isdigit((unsigned char) (*position)[i])) {
+            return false;
+        }
+    }
+    *position += count;
+    return true;
+}
+
+static int compareBackupCandidates(const void *first, const void *second) {
+    const LogBackupCandidate *firstCandidate = first;
+    const LogBackupCandidate *secondCandidate = second;
+    if (firstCandidate->modifiedTime != secondCandidate->modifiedTime) {
+        return firstCandidate->modifiedTime < secondCandidate->modifiedTime ? -1 : 1;
+    }
+    return strcmp(firstCandidate->name, secondCandidate->name);
+}
+
+static void formatBackupFileName(const char *fileBaseName, char *backupFileName, size_t length, time_t timestamp, bool isHourly) {   // Example: "dir1/dir2/fileName.log" -> "dir1/dir2/fileName_2023-05-02.log"
     char *nameEnd = strstr(fileBaseName, ".log");
     int pathLen = nameEnd - fileBaseName;
     strncpy(backupFileName, fileBaseName, pathLen);
 
-    time_t logTime = time(NULL);
-    struct tm *logLocalTime = localtime(&logTime);
-    strftime(backupFileName + pathLen, length - pathLen, "_%Y-%m-%d.log", logLocalTime);
+    struct tm logLocalTime;
+    convertToLocalTime(timestamp, &logLocalTime);
+    strftime(backupFileName + pathLen, length - pathLen, isHourly ? "_%Y-%m-%d_%H.log" : "_%Y-%m-%d.log", &logLocalTime);
 }
 
 static bool isLogFileExist(const char *fileName) {
@@ -432,22 +2374,112 @@ static bool isLogFileExist(const char *fileName) {
     return true;
 }
 
+static bool isBackupNameTaken(const LoggerEvent *event, const char *name) {   // backups are never overwritten, also untracked ones
+    for (uint8_t i = 1; i < event->maxBackupFiles; i++) {   // the first one is replaced by the new backup
+        if (strcmp(event->backupFiles[i].name, name) == 0) {
+            return true;
+        }
+    }
+    return isLogFileExist(name);
+}
+
 static void shiftBackupFilesLeft(LogFile *files, uint8_t length) {
     for (uint8_t i = 0; i < length - 1; i++) {
         files[i] = files[i + 1];
     }
 }
 
-static size_t formatTimestamp(char *buffer) {
-    time_t logTime;
-    time(&logTime);
-    struct tm *logLocalTime = localtime(&logTime);
-    return strftime(buffer, LOGGER_BUFFER_SIZE, "%d %b %Y %H:%M:%S", logLocalTime);
+static struct tm *convertToLocalTime(time_t timestamp, struct tm *localTime) {
+#if defined(_WIN32) || defined(_WIN64)
+    return localtime_s(localTime, &timestamp) == 0 ? localTime : NULL;
+#else
+    return localtime_r(&timestamp, localTime);
+#endif /* defined(_WIN32) || defined(_WIN64) */
+}
+
+static void readRealTime(struct timespec *timestamp) {
+#if defined(_WIN32) || defined(_WIN64)
+    timespec_get(timestamp, TIME_UTC);
+#else
+    clock_gettime(CLOCK_REALTIME, timestamp);
+#endif /* defined(_WIN32) || defined(_WIN64) */
+}
+
+static size_t formatTimestamp(char *buffer, struct timespec timestamp, LogTimestampPrecision precision) {  // "dd MMM yyyy hh:mm:ss[.fraction]"
+    if (timestampCache.second != timestamp.tv_sec) {
+        struct tm logLocalTime;
+        if (convertToLocalTime(timestamp.tv_sec, &logLocalTime) == NULL) {
+            return 0;
+        }
+
+        char *position = writeTwoDigits(timestampCache.text, logLocalTime.tm_mday);
+        *position++ = ' ';
+        memcpy(position, MONTH_NAMES[logLocalTime.tm_mon], 3);
+        position += 3;
+        *position++ = ' ';
+        position = writeFixedDigits(position, logLocalTime.tm_year + 1900, 4);
+        *position++ = ' ';
+        position = writeTwoDigits(position, logLocalTime.tm_hour);
+        *position++ = ':';
+        position = writeTwoDigits(position, logLocalTime.tm_min);
+        *position++ = ':';
+        position = writeTwoDigits(position, logLocalTime.tm_sec);
+        timestampCache.length = position - timestampCache.text;
+        timestampCache.second = timestamp.tv_sec;
+    }
+    memcpy(buffer, timestampCache.text, timestampCache.length);
+    if (precision == LOG_TIMESTAMP_SECONDS) {
+        return timestampCache.length;
+    }
+    buffer[timestampCache.length] = '.';
+    char *end = writeFixedDigits(buffer + timestampCache.length + 1, timestamp.tv_nsec / FRACTION_DIVIDERS[precision], FRACTION_DIGITS[precision]);
+    return end - buffer;
+}
+
+static char *writeTwoDigits(char *buffer, uint32_t value) {
+    memcpy(buffer, &DIGIT_PAIRS[value * 2], 2);
+    return buffer + 2;
+}
+
+static char *writeFixedDigits(char *buffer, uint32_t value, uint8_t digits) {    // zero padded, written from the end by digit pairs
+    char *end = buffer + digits;
+    char *position = end;
+    if (digits & 1) {
+        *--position = (char) ('0' + value % 10);
+        value /= 10;
+    }
+
+    while (position > buffer) {
+        position -= 2;
+        memcpy(position, &DIGIT_PAIRS[(value % 100) * 2], 2);
+        value /= 100;
+    }
+    return end;
 }
 
 #ifdef USE_LOGGER_COLOR
 static size_t formatColoredTagLevel(char *buffer, const char *tag, LogLevel severity, size_t timestampLength) {
-    return snprintf(buffer + timestampLength, LOGGER_BUFFER_SIZE - timestampLength, " | %s%-5s\x1b[0m | %s - ", LEVEL_COLORS[severity], logLevelToString(severity), tag);
+    const char *color = LEVEL_COLORS[severity <= LOG_LEVEL_FATAL ? severity : LOG_LEVEL_UNKNOWN];
+    return snprintf(buffer + timestampLength, LOGGER_BUFFER_SIZE - timestampLength, " | %s%-5s\x1b[0m | %s - ", color, logLevelToString(severity), tag);
+}
+
+static void renderColoredRecord(LogRecord *record) {    // reuse rendered timestamp and message, only level prefix differs
+    if (record->coloredLine != NULL) return;
+    record->coloredLine = coloredLineBuffer;
+    memcpy(record->coloredLine, record->line, record->timestampLength);
+    size_t prefixLength = record->timestampLength + formatColoredTagLevel(record->coloredLine, record->tag, record->severity, record->timestampLength);
+    if (prefixLength > LOGGER_BUFFER_SIZE - 2) {
+        prefixLength = LOGGER_BUFFER_SIZE - 2;
+    }
+
+    size_t messageLength = record->length - record->messageOffset - 1;  // without new line
+    if (prefixLength + messageLength > LOGGER_BUFFER_SIZE - 2) {    // same truncation rules as for plain line
+        messageLength = LOGGER_BUFFER_SIZE - 2 - prefixLength;
+    }
+    memcpy(record->coloredLine + prefixLength, record->line + record->messageOffset, messageLength);
+    record->coloredLength = prefixLength + messageLength;
+    record->coloredLine[record->coloredLength++] = '\n';
+    record->coloredLine[record->coloredLength] = '\0';
 }
 #endif
 
@@ -455,16 +2487,41 @@ static size_t formatTagLevel(char *buffer, const char *tag, LogLevel severity, s
     return snprintf(buffer + timestampLength, LOGGER_BUFFER_SIZE - timestampLength, " | %s | %s - ", logLevelToString(severity), tag);
 }
 
-static size_t formatLogMessage(char *buffer, const char *format, va_list list, size_t prefixLength) {
-    size_t bufferSize = LOGGER_BUFFER_SIZE - prefixLength - 1;
-    size_t messageLength = vsnprintf(buffer + prefixLength, bufferSize, format, list);
-    size_t totalMessageLength = prefixLength + messageLength;
+static void renderRecordPrefix(LogRecord *record, LogTimestampPrecision precision) {
+    record->timestampLength = formatTimestamp(record->line, record->timestamp, precision);
+    record->messageOffset = record->timestampLength + formatTagLevel(record->line, record->tag, record->severity, record->timestampLength);
+    if (record->messageOffset > LOGGER_BUFFER_SIZE - 2) {   // too long tag
+        record->messageOffset = LOGGER_BUFFER_SIZE - 2;
+    }
+}
 
-    if (totalMessageLength >= LOGGER_BUFFER_SIZE) {     // check for truncation
+static void completeRecord(LogRecord *record, size_t messageLength) {
+    size_t totalMessageLength = record->messageOffset + messageLength;
+    if (totalMessageLength >= LOGGER_BUFFER_SIZE - 1) {     // check for truncation
         totalMessageLength = LOGGER_BUFFER_SIZE - 2;    // length before line terminator + new line
     }
-    buffer[totalMessageLength] = '\n';
-    return totalMessageLength + 1;
+    record->line[totalMessageLength] = '\n';
+    record->line[totalMessageLength + 1] = '\0';
+    record->length = totalMessageLength + 1;
+#ifdef USE_LOGGER_COLOR
+    if (atomic_load_explicit(&hasConsoleSubscriber, memory_order_relaxed)) {
+        renderColoredRecord(record);
+    }
+#endif
+}
+
+static void renderRecord(LogRecord *record, const char *format, va_list list) {
+    renderRecordPrefix(record, atomic_load_explicit(&timestampPrecision, memory_order_relaxed));
+    size_t bufferSize = LOGGER_BUFFER_SIZE - record->messageOffset - 1;
+    size_t messageLength = vsnprintf(record->line + record->messageOffset, bufferSize, format, list);
+    completeRecord(record, messageLength);
+}
+
+static void renderMessage(LogRecord *record, const char *format, ...) {
+    va_list list;
+    va_start(list, format);
+    renderRecord(record, format, list);
+    va_end(list);
 }
 
 int strCompareICase(const char *one, const char *two) {
@@ -478,4 +2535,595 @@ int strCompareICase(const char *one, const char *two) {
     } while (charOfOne == charOfTwo && charOfOne != '\0');
 
     return charOfOne - charOfTwo;
-}
\ No newline at end of file
+}
+
+static const LogFormat *getSiteFormat(LoggerSite *site, const char *format) {
+    LogFormat *siteFormat = atomic_load_explicit(&site->format, memory_order_acquire);
+    if (siteFormat == NULL) {   // first call from this site, parse format string once
+        LogFormat *parsedFormat = parseLogFormat(format);
+        if (parsedFormat == NULL) {
+            return NULL;
+        }
+        if (parsedFormat->isDeferrable) {   // ids are given only to live formats, decoded files don't shift them
+            unsigned int id = atomic_fetch_add(&lastFormatId, 1) + 1;
+            parsedFormat->id = (id < UINT16_MAX && strlen(format) < UINT16_MAX) ? (uint16_t) id : 0;
+        }
+        if (atomic_compare_exchange_strong(&site->format, &siteFormat, parsedFormat)) {
+            siteFormat = parsedFormat;
+        } else {    // other thread was first
+            free(parsedFormat);
+        }
+    }
+    // same site with other format string (format passed as variable) is formatted eagerly
+    return (siteFormat->isDeferrable && siteFormat->format == format) ? siteFormat : NULL;
+}
+
+static LogFormat *parseLogFormat(const char *format) {
+    LogFormat *logFormat = calloc(1, sizeof(LogFormat));
+    if (logFormat == NULL) {
+        return NULL;
+    }
+    logFormat->format = format;
+    logFormat->isDeferrable = true;
+
+    for (const char *cursor = format; *cursor != '\0'; cursor++) {
+        if (*cursor != '%') {
+            continue;
+        }
+        if (logFormat->conversionCount >= LOGGER_MAX_DEFERRED_ARGUMENTS || (cursor - format) > UINT16_MAX) {
+            logFormat->isDeferrable = false;
+            break;
+        }
+
+        LogConversion *conversion = &logFormat->conversions[logFormat->conversionCount];
+        conversion->offset = (uint16_t) (cursor - format);
+        conversion->precision = -1;
+        const char *specification = cursor++;
+
+        while (strchr("-+ #0'", *cursor) != NULL && *cursor != '\0') {  // flags
+            cursor++;
+        }
+        if (*cursor == '*') {   // width
+            conversion->starCount++;
+            cursor++;
+        } else {
+            while (isdigit((unsigned char) *cursor)) cursor++;
+        }
+        if (*cursor == '.') {   // precision
+            cursor++;
+            if (*cursor == '*') {
+                conversion->starCount++;
+                conversion->hasStarPrecision = true;
+                cursor++;
+            } else {
+                conversion->precision = (int16_t) strtol(cursor, NULL, 10);
+                while (isdigit((unsigned char) *cursor)) cursor++;
+            }
+        }
+
+        LogArgumentType integerType = LOG_ARGUMENT_INT;
+        bool isLongDouble = false;
+        bool isLong = false;
+        switch (*cursor) {  // length modifier
+            case 'h':
+                cursor += (cursor[1] == 'h') ? 2 : 1;   // promoted to int
+                break;
+            case 'l':
+                isLong = cursor[1] != 'l';
+                integerType = isLong ? LOG_ARGUMENT_LONG : LOG_ARGUMENT_LONG_LONG;
+                cursor += isLong ? 1 : 2;
+                break;
+            case 'z':
+                integerType = LOG_ARGUMENT_SIZE;
+                cursor++;
+                break;
+            case 'j':
+                integerType = LOG_ARGUMENT_INTMAX;
+                cursor++;
+                break;
+            case 't':
+                integerType = LOG_ARGUMENT_PTRDIFF;
+                cursor++;
+                break;
+            case 'L':
+                isLongDouble = true;
+                cursor++;
+                break;
+            default:
+                break;
+        }
+
+        switch (*cursor) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+                conversion->type = integerType;
+                logFormat->isDeferrable = !isLongDouble;
+                break;
+            case 'c':
+                conversion->type = LOG_ARGUMENT_INT;
+                logFormat->isDeferrable = !isLong && integerType == LOG_ARGUMENT_INT;   // wide char not supported
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                conversion->type = isLongDouble ? LOG_ARGUMENT_LONG_DOUBLE : LOG_ARGUMENT_DOUBLE;
+                break;
+            case 's':
+                conversion->type = LOG_ARGUMENT_STRING;
+                logFormat->isDeferrable = integerType == LOG_ARGUMENT_INT && !isLongDouble;   // wide string not supported
+                break;
+            case 'p':
+                conversion->type = LOG_ARGUMENT_POINTER;
+                break;
+            case '%':
+                conversion->type = LOG_ARGUMENT_PERCENT;
+                break;
+            default:    // "%n", unknown or unterminated conversion
+                logFormat->isDeferrable = false;
+                break;
+        }
+
+        size_t conversionLength = cursor - specification + 1;
+        if (!logFormat->isDeferrable || conversionLength >= CONVERSION_MAX_LENGTH) {
+            logFormat->isDeferrable = false;
+            break;
+        }
+        conversion->length = (uint8_t) conversionLength;
+        logFormat->conversionCount++;
+    }
+    return logFormat;
+}
+
+static bool captureArguments(const LogFormat *format, va_list list, uint8_t *buffer, size_t capacity, uint16_t *length) {
+    size_t position = 0;
+
+#define CAPTURE_ARGUMENT(TYPE) do {                     \
+        TYPE argument = va_arg(list, TYPE);             \
+        if (position + sizeof(TYPE) > capacity) {       \
+            return false;                               \
+        }                                               \
+        memcpy(buffer + position, &argument, sizeof(TYPE));    \
+        position += sizeof(TYPE);                       \
+    } while (0)
+
+    for (uint8_t i = 0; i < format->conversionCount; i++) {
+        const LogConversion *conversion = &format->conversions[i];
+        int precision = conversion->precision;
+        for (uint8_t star = 0; star < conversion->starCount; star++) {
+            int starValue = va_arg(list, int);
+            if (position + sizeof(int) > capacity) {
+                return false;
+            }
+            memcpy(buffer + position, &starValue, sizeof(int));
+            position += sizeof(int);
+            if (conversion->hasStarPrecision && star == conversion->starCount - 1) {
+                precision = starValue;
+            }
+        }
+
+        switch (conversion->type) {
+            case LOG_ARGUMENT_PERCENT: break;
+            case LOG_ARGUMENT_INT: CAPTURE_ARGUMENT(int); break;
+            case LOG_ARGUMENT_LONG: CAPTURE_ARGUMENT(long); break;
+            case LOG_ARGUMENT_LONG_LONG: CAPTURE_ARGUMENT(long long); break;
+            case LOG_ARGUMENT_SIZE: CAPTURE_ARGUMENT(size_t); break;
+            case LOG_ARGUMENT_INTMAX: CAPTURE_ARGUMENT(intmax_t); break;
+            case LOG_ARGUMENT_PTRDIFF: CAPTURE_ARGUMENT(ptrdiff_t); break;
+            case LOG_ARGUMENT_DOUBLE: CAPTURE_ARGUMENT(double); break;
+            case LOG_ARGUMENT_LONG_DOUBLE: CAPTURE_ARGUMENT(long double); break;
+            case LOG_ARGUMENT_POINTER: CAPTURE_ARGUMENT(void *); break;
+            case LOG_ARGUMENT_STRING: {     // string content is copied, pointer can be invalid after return
+                const char *string = va_arg(list, const char *);
+                uint16_t stringLength = NULL_STRING_LENGTH;
+                size_t maxLength = (precision >= 0) ? (size_t) precision : NULL_STRING_LENGTH - 1;
+                if (string != NULL) {
+                    stringLength = (uint16_t) strnlen(string, maxLength < capacity ? maxLength : capacity);
+                }
+                size_t copyLength = (string != NULL) ? stringLength : 0;
+                if (position + sizeof(uint16_t) + copyLength + 1 > capacity) {
+                    return false;
+                }
+                memcpy(buffer + position, &stringLength, sizeof(uint16_t));
+                position += sizeof(uint16_t);
+                memcpy(buffer + position, string != NULL ? string : "", copyLength);
+                position += copyLength;
+                buffer[position++] = '\0';
+                break;
+            }
+        }
+    }
+#undef CAPTURE_ARGUMENT
+
+    *length = (uint16_t) position;
+    return true;
+}
+
+static bool isCapturedArgumentsValid(const LogFormat *format, const uint8_t *arguments, size_t length) {  // arguments read from file
+    size_t position = 0;
+    for (uint8_t i = 0; i < format->conversionCount; i++) {
+        const LogConversion *conversion = &format->conversions[i];
+        size_t size = conversion->starCount * sizeof(int);
+        switch (conversion->type) {
+            case LOG_ARGUMENT_PERCENT: break;
+            case LOG_ARGUMENT_INT: size += sizeof(int); break;
+            case LOG_ARGUMENT_LONG: size += sizeof(long); break;
+            case LOG_ARGUMENT_LONG_LONG: size += sizeof(long long); break;
+            case LOG_ARGUMENT_SIZE: size += sizeof(size_t); break;
+            case LOG_ARGUMENT_INTMAX: size += sizeof(intmax_t); break;
+            case LOG_ARGUMENT_PTRDIFF: size += sizeof(ptrdiff_t); break;
+            case LOG_ARGUMENT_DOUBLE: size += sizeof(double); break;
+            case LOG_ARGUMENT_LONG_DOUBLE: size += sizeof(long double); break;
+            case LOG_ARGUMENT_POINTER: size += sizeof(void *); break;
+            case LOG_ARGUMENT_STRING: {
+                if (position + size + sizeof(uint16_t) > length) {
+                    return false;
+                }
+                uint16_t stringLength;
+                memcpy(&stringLength, arguments + position + size, sizeof(uint16_t));
+                size += sizeof(uint16_t);
+                size_t copyLength = (stringLength == NULL_STRING_LENGTH) ? 0 : stringLength;
+                if (position + size + copyLength + 1 > length || arguments[position + size + copyLength] != '\0' ||
+                    strnlen((const char *) arguments + position + size, copyLength) != copyLength) {
+                    return false;   // string is terminated exactly at its stored length
+                }
+                size += copyLength + 1;
+                break;
+            }
+        }
+
+        if (position + size > length) {
+            return false;
+        }
+        position += size;
+    }
+    return true;
+}
+
+static size_t formatDeferredMessage(char *buffer, size_t size, const LogFormat *format, const uint8_t *arguments) {
+    size_t messageLength = 0;
+    size_t formatOffset = 0;
+    char specification[CONVERSION_MAX_LENGTH];
+
+#define FORMAT_VALUE(VALUE) do {                            \
+        char *output = (messageLength < size) ? buffer + messageLength : NULL;   \
+        size_t outputSize = (messageLength < size) ? size - messageLength : 0;   \
+        int written;                                        \
+        if (conversion->starCount == 2) {                   \
+            written = snprintf(output, outputSize, specification, stars[0], stars[1], VALUE);  \
+        } else if (conversion->starCount == 1) {            \
+            written = snprintf(output, outputSize, specification, stars[0], VALUE);   \
+        } else {                                            \
+            written = snprintf(output, outputSize, specification, VALUE);   \
+        }                                                   \
+        messageLength += (written > 0) ? (size_t) written : 0;  \
+    } while (0)
+
+#define FORMAT_ARGUMENT(TYPE) do {                          \
+        TYPE argument;                                      \
+        memcpy(&argument, arguments, sizeof(TYPE));         \
+        arguments += sizeof(TYPE);                          \
+        FORMAT_VALUE(argument);                             \
+    } while (0)
+
+    for (uint8_t i = 0; i <= format->conversionCount; i++) {
+        const LogConversion *conversion = (i < format->conversionCount) ? &format->conversions[i] : NULL;
+        size_t literalLength = (conversion != NULL) ? conversion->offset - formatOffset : strlen(format->format + formatOffset);
+        if (messageLength < size) {     // plain text before conversion
+            size_t copyLength = (literalLength < size - messageLength - 1) ? literalLength : size - messageLength - 1;
+            memcpy(buffer + messageLength, format->format + formatOffset, copyLength);
+            buffer[messageLength + copyLength] = '\0';
+        }
+        messageLength += literalLength;
+        if (conversion == NULL) {
+            break;
+        }
+
+        formatOffset = conversion->offset + conversion->length;
+        memcpy(specification, format->format + conversion->offset, conversion->length);
+        specification[conversion->length] = '\0';
+        int stars[2] = {0};
+        for (uint8_t star = 0; star < conversion->starCount; star++) {
+            memcpy(&stars[star], arguments, sizeof(int));
+            arguments += sizeof(int);
+        }
+
+        switch (conversion->type) {
+            case LOG_ARGUMENT_PERCENT: {
+                if (messageLength + 1 < size) {
+                    buffer[messageLength] = '%';
+                    buffer[messageLength + 1] = '\0';
+                }
+                messageLength++;
+                break;
+            }
+            case LOG_ARGUMENT_INT: FORMAT_ARGUMENT(int); break;
+            case LOG_ARGUMENT_LONG: FORMAT_ARGUMENT(long); break;
+            case LOG_ARGUMENT_LONG_LONG: FORMAT_ARGUMENT(long long); break;
+            case LOG_ARGUMENT_SIZE: FORMAT_ARGUMENT(size_t); break;
+            case LOG_ARGUMENT_INTMAX: FORMAT_ARGUMENT(intmax_t); break;
+            case LOG_ARGUMENT_PTRDIFF: FORMAT_ARGUMENT(ptrdiff_t); break;
+            case LOG_ARGUMENT_DOUBLE: FORMAT_ARGUMENT(double); break;
+            case LOG_ARGUMENT_LONG_DOUBLE: FORMAT_ARGUMENT(long double); break;
+            case LOG_ARGUMENT_POINTER: FORMAT_ARGUMENT(void *); break;
+            case LOG_ARGUMENT_STRING: {
+                uint16_t stringLength;
+                memcpy(&stringLength, arguments, sizeof(uint16_t));
+                arguments += sizeof(uint16_t);
+                const char *string = (stringLength == NULL_STRING_LENGTH) ? "(null)" : (const char *) arguments;
+                arguments += (stringLength == NULL_STRING_LENGTH) ? 1 : stringLength + 1;
+                FORMAT_VALUE(string);
+                break;
+            }
+        }
+    }
+#undef FORMAT_ARGUMENT
+#undef FORMAT_VALUE
+
+    return messageLength;
+}
+
+static void writeBinaryData(LoggerEvent *event, const void *data, size_t length) {
+    fwrite(data, sizeof(uint8_t), length, event->file->out);
+    event->file->size += length;
+}
+
+static void writeBinaryHeader(LoggerEvent *event, struct timespec timestamp) {  // "LOGB", version, precision, byte order, type sizes
+    uint8_t header[8 + BINARY_TYPE_SIZE_COUNT] = {'L', 'O', 'G', 'B', BINARY_FILE_VERSION};
+    header[5] = (uint8_t) atomic_load(&timestampPrecision);
+    uint16_t byteOrder = 0x0102;
+    memcpy(&header[6], &byteOrder, sizeof(byteOrder));
+    getBinaryTypeSizes(&header[8]);
+    writeBinaryData(event, header, sizeof(header));
+
+    resetBinaryDictionary(event->dictionary);
+    writeBinaryTime(event, timestamp);
+    event->dictionary->isHeaderWritten = true;
+}
+
+static void writeBinaryTime(LoggerEvent *event, struct timespec timestamp) {
+    uint8_t type = LOG_BINARY_TIME;
+    int64_t seconds = timestamp.tv_sec;
+    int32_t nanoseconds = (int32_t) timestamp.tv_nsec;
+    writeBinaryData(event, &type, sizeof(type));
+    writeBinaryData(event, &seconds, sizeof(seconds));
+    writeBinaryData(event, &nanoseconds, sizeof(nanoseconds));
+    event->dictionary->lastTimestamp = timestamp;
+}
+
+static void writeBinaryDictionaryEntry(LoggerEvent *event, LogBinaryEntryType type, uint16_t id, const char *text) {
+    uint8_t entryType = type;
+    size_t textLength = strlen(text);
+    uint16_t length = (uint16_t) (textLength < UINT16_MAX ? textLength : UINT16_MAX);
+    writeBinaryData(event, &entryType, sizeof(entryType));
+    writeBinaryData(event, &id, sizeof(id));
+    writeBinaryData(event, &length, sizeof(length));
+    writeBinaryData(event, text, length);
+}
+
+static uint16_t writeBinaryTag(LoggerEvent *event, const char *tag) {
+    LogBinaryDictionary *dictionary = event->dictionary;
+    tag = (tag != NULL) ? tag : "";
+    uint32_t index = hashTag(tag) % LOGGER_BINARY_MAX_TAGS;
+    for (uint32_t i = 0; i < LOGGER_BINARY_MAX_TAGS; i++) {
+        LogBinaryTag *entry = &dictionary->tags[(index + i) % LOGGER_BINARY_MAX_TAGS];
+        if (entry->name == NULL) {
+            size_t length = strlen(tag) + 1;
+            entry->name = malloc(length);
+            if (entry->name == NULL) {
+                break;
+            }
+            memcpy(entry->name, tag, length);
+            entry->id = ++dictionary->tagCount;
+            writeBinaryDictionaryEntry(event, LOG_BINARY_TAG, entry->id, tag);
+            return entry->id;
+        }
+
+        if (strcmp(entry->name, tag) == 0) {
+            return entry->id;
+        }
+    }
+
+    writeBinaryDictionaryEntry(event, LOG_BINARY_TAG, BINARY_TEMPORARY_TAG_ID, tag);  // dictionary is full
+    return BINARY_TEMPORARY_TAG_ID;
+}
+
+static void writeBinaryFormat(LoggerEvent *event, const LogFormat *format) {
+    LogBinaryDictionary *dictionary = event->dictionary;
+    uint32_t byteIndex = format->id / 8;
+    if (byteIndex >= dictionary->writtenFormatsSize) {
+        uint32_t size = (byteIndex + 1) * 2;
+        uint8_t *writtenFormats = realloc(dictionary->writtenFormats, size);
+        if (writtenFormats == NULL) {   // format can't be remembered, so write it with each message
+            writeBinaryDictionaryEntry(event, LOG_BINARY_FORMAT, format->id, format->format);
+            return;
+        }
+        memset(writtenFormats + dictionary->writtenFormatsSize, 0, size - dictionary->writtenFormatsSize);
+        dictionary->writtenFormats = writtenFormats;
+        dictionary->writtenFormatsSize = size;
+    }
+
+    uint8_t mask = 1 << (format->id % 8);
+    if ((dictionary->writtenFormats[byteIndex] & mask) == 0) {
+        writeBinaryDictionaryEntry(event, LOG_BINARY_FORMAT, format->id, format->format);
+        dictionary->writtenFormats[byteIndex] |= mask;
+    }
+}
+
+static void resetBinaryDictionary(LogBinaryDictionary *dictionary) {
+    for (uint32_t i = 0; i < LOGGER_BINARY_MAX_TAGS; i++) {
+        free(dictionary->tags[i].name);
+        dictionary->tags[i].name = NULL;
+    }
+    dictionary->tagCount = 0;
+    if (dictionary->writtenFormats != NULL) {
+        memset(dictionary->writtenFormats, 0, dictionary->writtenFormatsSize);
+    }
+}
+
+static void getBinaryTypeSizes(uint8_t *sizes) {   // captured arguments are stored in native layout
+    const uint8_t typeSizes[BINARY_TYPE_SIZE_COUNT] = {
+            sizeof(int), sizeof(long), sizeof(long long), sizeof(size_t), sizeof(intmax_t),
+            sizeof(ptrdiff_t), sizeof(double), sizeof(long double), sizeof(void *)};
+    memcpy(sizes, typeSizes, BINARY_TYPE_SIZE_COUNT);
+}
+
+static uint32_t hashTag(const char *tag) {  // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*tag != '\0') {
+        hash ^= (uint8_t) *tag++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool loggerDecodeBinaryFile(FILE *input, FILE *output) {
+    if (input == NULL || output == NULL) {
+        fprintf(stderr, "ERROR: Mandatory parameter [input] or [output] is NULL\n");
+        return false;
+    }
+
+    LogFormat **formats = calloc(UINT16_MAX + 1, sizeof(LogFormat *));
+    char **tags = calloc(UINT16_MAX + 1, sizeof(char *));
+    uint8_t *arguments = calloc(UINT16_MAX + sizeof(uint64_t), sizeof(uint8_t));   // zero tail guards truncated strings
+    if (formats == NULL || tags == NULL || arguments == NULL) {
+        fprintf(stderr, "ERROR: Memory allocation fail while decoding binary log file\n");
+        free(formats);
+        free(tags);
+        free(arguments);
+        return false;
+    }
+
+    LogTimestampPrecision precision = LOGGER_TIMESTAMP_PRECISION;    // of decoded file, process wide precision is not changed
+    struct timespec timestamp = {0};
+    bool isHeaderFound = false;
+    bool isDecoded = true;
+    uint8_t type;
+    while (isDecoded && fread(&type, sizeof(type), 1, input) == 1) {
+        switch (type) {
+            case LOG_BINARY_HEADER: {
+                uint8_t header[7 + BINARY_TYPE_SIZE_COUNT];
+                uint8_t typeSizes[BINARY_TYPE_SIZE_COUNT];
+                uint16_t byteOrder;
+                getBinaryTypeSizes(typeSizes);
+                isDecoded = readBinaryData(input, header, sizeof(header));
+                memcpy(&byteOrder, &header[5], sizeof(byteOrder));
+                if (!isDecoded || memcmp(header, "OGB", 3) != 0 || header[3] != BINARY_FILE_VERSION || header[4] > LOG_TIMESTAMP_NANOSECONDS ||
+                    byteOrder != 0x0102 || memcmp(&header[7], typeSizes, BINARY_TYPE_SIZE_COUNT) != 0) {
+                    isDecoded = false;  // other version or file written on platform with other type sizes
+                    break;
+                }
+                precision = header[4];
+                isHeaderFound = true;
+                break;
+            }
+            case LOG_BINARY_TIME: {
+                int64_t seconds;
+                int32_t nanoseconds;
+                isDecoded = readBinaryData(input, &seconds, sizeof(seconds)) && readBinaryData(input, &nanoseconds, sizeof(nanoseconds));
+                timestamp.tv_sec = (time_t) seconds;
+                timestamp.tv_nsec = nanoseconds;
+                break;
+            }
+            case LOG_BINARY_TAG: {
+                uint16_t id;
+                char *tag = readBinaryText(input, &id);
+                isDecoded = tag != NULL;
+                if (isDecoded) {
+                    free(tags[id]);
+                    tags[id] = tag;
+                }
+                break;
+            }
+            case LOG_BINARY_FORMAT: {
+                uint16_t id;
+                char *text = readBinaryText(input, &id);
+                LogFormat *format = (text != NULL) ? parseLogFormat(text) : NULL;
+                isDecoded = format != NULL && format->isDeferrable;
+                if (formats[id] != NULL) {
+                    free((char *) formats[id]->format);
+                    free(formats[id]);
+                }
+                formats[id] = format;
+                if (format == NULL) {
+                    free(text);
+                }
+                break;
+            }
+            case LOG_BINARY_RECORD: {
+                LogBinaryRecordHeader header = {.type = type};
+                isDecoded = isHeaderFound &&
+                            readBinaryData(input, &header.severity, sizeof(header.severity)) &&
+                            readBinaryData(input, &header.tagId, sizeof(header.tagId)) &&
+                            readBinaryData(input, &header.formatId, sizeof(header.formatId)) &&
+                            readBinaryData(input, &header.length, sizeof(header.length)) &&
+                            readBinaryData(input, &header.timestampDelta, sizeof(header.timestampDelta)) &&
+                            readBinaryData(input, arguments, header.length) &&
+                            (header.formatId == 0 || formats[header.formatId] != NULL);
+                if (!isDecoded) {
+                    break;
+                }
+                memset(arguments + header.length, 0, sizeof(uint64_t));
+
+                int64_t nanoseconds = (int64_t) timestamp.tv_nsec + header.timestampDelta;
+                timestamp.tv_sec += (time_t) (nanoseconds / 1000000000);
+                timestamp.tv_nsec = (long) (nanoseconds % 1000000000);
+                LogRecord record = {
+                        .tag = tags[header.tagId] != NULL ? tags[header.tagId] : "",
+                        .severity = header.severity <= LOG_LEVEL_FATAL ? header.severity : LOG_LEVEL_UNKNOWN,
+                        .timestamp = timestamp,
+                        .line = lineBuffer
+                };
+                renderRecordPrefix(&record, precision);
+                char *recordMessage = record.line + record.messageOffset;
+                size_t messageCapacity = LOGGER_BUFFER_SIZE - record.messageOffset - 1;
+                if (header.formatId != 0) {
+                    if (!isCapturedArgumentsValid(formats[header.formatId], arguments, header.length)) {
+                        isDecoded = false;  // truncated or corrupted arguments, record is rejected
+                        break;
+                    }
+                    completeRecord(&record, formatDeferredMessage(recordMessage, messageCapacity, formats[header.formatId], arguments));
+                } else {
+                    size_t messageLength = (header.length < messageCapacity) ? header.length : messageCapacity - 1;
+                    memcpy(recordMessage, arguments, messageLength);
+                    completeRecord(&record, messageLength);
+                }
+                fwrite(record.line, sizeof(char), record.length, output);
+                break;
+            }
+            default:
+                isDecoded = false;
+                break;
+        }
+    }
+
+    if (!isDecoded) {
+        fprintf(stderr, "ERROR: Unsupported or corrupted binary log file at position: [%ld]\n", ftell(input));
+    }
+    for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+        if (formats[i] != NULL) {
+            free((char *) formats[i]->format);
+            free(formats[i]);
+        }
+        free(tags[i]);
+    }
+    free(formats);
+    free(tags);
+    free(arguments);
+    return isDecoded;
+}
+
+static bool readBinaryData(FILE *input, void *data, size_t length) {
+    return fread(data, sizeof(uint8_t), length, input) == length;
+}
+
+static char *readBinaryText(FILE *input, uint16_t *id) {
+    uint16_t length;
+    if (!readBinaryData(input, id, sizeof(uint16_t)) || !readBinaryData(input, &length, sizeof(length))) {
+        return NULL;
+    }
+
+    char *text = malloc(length + 1);
+    if (text == NULL || !readBinaryData(input, text, length)) {
+        free(text);
+        return NULL;
+    }
+    text[length] = '\0';
+    return text;
+}
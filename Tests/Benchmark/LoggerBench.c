@@ -0,0 +1,336 @@
+#include <getopt.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include "Logger.h"
+
+// Measures logMessage() throughput and per call latency for each sink, thread count, message size and filtered ratio.
+// Results are printed as JSON lines, console sink output is redirected to /dev/null.
+
+#define BENCH_MAX_THREADS 64
+#define BENCH_FILE_NAME "logger_bench.log"
+#define BENCH_MAX_FILE_SIZE (1024UL * 1024UL * 1024UL)
+
+typedef enum BenchSink {
+    BENCH_SINK_CONSOLE,
+    BENCH_SINK_FILE,
+    BENCH_SINK_CUSTOM,
+} BenchSink;
+
+typedef struct BenchConfig {
+    BenchSink sink;
+    const char *directory;
+    uint32_t threadCount;
+    uint32_t messageCount;      // per thread
+    uint32_t messageSize;
+    double filteredRatio;
+    bool isAsync;
+    LogFileSyncMode syncMode;
+    uint32_t bufferSize;
+} BenchConfig;
+
+typedef struct BenchThread {
+    pthread_t thread;
+    const BenchConfig *config;
+    const char *message;
+    uint64_t *latencies;
+} BenchThread;
+
+static const char *SINK_NAMES[] = {
+        [BENCH_SINK_CONSOLE] = "console",
+        [BENCH_SINK_FILE] = "file",
+        [BENCH_SINK_CUSTOM] = "custom"};
+
+static const char *SYNC_MODE_NAMES[] = {
+        [LOG_FILE_SYNC_ALWAYS] = "always",
+        [LOG_FILE_SYNC_FLUSH] = "flush",
+        [LOG_FILE_SYNC_PERIODIC] = "periodic",
+        [LOG_FILE_SYNC_NONE] = "none"};
+
+static pthread_barrier_t startBarrier;
+static atomic_uint_fast64_t customSinkBytes;
+static FILE *resultOutput;
+
+
+static uint64_t nowNs() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+static void customSinkCallback(LogLevel severity, const char *message, uint32_t length) {
+    (void) severity;
+    (void) message;
+    atomic_fetch_add_explicit(&customSinkBytes, length, memory_order_relaxed);
+}
+
+static void *benchThreadRun(void *argument) {
+    BenchThread *benchThread = argument;
+    const BenchConfig *config = benchThread->config;
+    uint32_t filteredPerMille = (uint32_t) (config->filteredRatio * 1000.0);
+    pthread_barrier_wait(&startBarrier);
+
+    for (uint32_t i = 0; i < config->messageCount; i++) {
+        uint64_t start = nowNs();
+        if ((i % 1000) < filteredPerMille) {
+            LOG_DEBUG("BENCH", "%s [%u]", benchThread->message, i);
+        } else {
+            LOG_INFO("BENCH", "%s [%u]", benchThread->message, i);
+        }
+        benchThread->latencies[i] = nowNs() - start;
+    }
+    return NULL;
+}
+
+static int compareLatency(const void *one, const void *two) {
+    uint64_t first = *(const uint64_t *) one;
+    uint64_t second = *(const uint64_t *) two;
+    return (first > second) - (first < second);
+}
+
+static uint64_t percentile(const uint64_t *sorted, size_t length, double fraction) {
+    size_t index = (size_t) (fraction * (double) (length - 1));
+    return sorted[index];
+}
+
+static LoggerEvent *subscribeBenchSink(const BenchConfig *config, char *fileName) {
+    switch (config->sink) {
+        case BENCH_SINK_CONSOLE:
+            return subscribeConsoleLogger(LOG_LEVEL_INFO);
+        case BENCH_SINK_FILE: {
+            snprintf(fileName, LOGGER_FILE_NAME_MAX_SIZE, "%s/%s", config->directory, BENCH_FILE_NAME);
+            remove(fileName);
+            LogFileConfig fileConfig = {
+                    .fileName = fileName,
+                    .maxFileSize = BENCH_MAX_FILE_SIZE,
+                    .sync = {.mode = config->syncMode, .bytes = 1024 * 1024, .intervalMs = 1000},
+                    .bufferSize = config->bufferSize
+            };
+            return subscribeFileLoggerWithConfig(LOG_LEVEL_INFO, &fileConfig);
+        }
+        case BENCH_SINK_CUSTOM:
+            return subscribeCustomLogger(LOG_LEVEL_INFO, customSinkCallback);
+    }
+    return NULL;
+}
+
+static bool runBenchmark(const BenchConfig *config) {
+    char fileName[LOGGER_FILE_NAME_MAX_SIZE] = {0};
+    LoggerEvent *event = subscribeBenchSink(config, fileName);
+    if (event == NULL || !event->isSubscribed) {
+        fprintf(stderr, "Failed to subscribe [%s] sink: %s\n", SINK_NAMES[config->sink], event != NULL ? event->buffer : "");
+        return false;
+    }
+
+    if (config->isAsync && !loggerStartAsync(0)) {
+        loggerUnsubscribeAll();
+        return false;
+    }
+
+    char *message = malloc(config->messageSize + 1);
+    size_t latencyCount = (size_t) config->threadCount * config->messageCount;
+    uint64_t *latencies = malloc(latencyCount * sizeof(uint64_t));
+    if (message == NULL || latencies == NULL) {
+        fprintf(stderr, "Memory allocation fail\n");
+        free(message);
+        free(latencies);
+        loggerStopAsync();
+        loggerUnsubscribeAll();
+        return false;
+    }
+    memset(message, 'x', config->messageSize);
+    message[config->messageSize] = '\0';
+
+    BenchThread threads[BENCH_MAX_THREADS];
+    pthread_barrier_init(&startBarrier, NULL, config->threadCount + 1);
+    for (uint32_t i = 0; i < config->threadCount; i++) {
+        threads[i] = (BenchThread) {.config = config, .message = message, .latencies = latencies + (size_t) i * config->messageCount};
+        pthread_create(&threads[i].thread, NULL, benchThreadRun, &threads[i]);
+    }
+
+    uint64_t start = nowNs();
+    pthread_barrier_wait(&startBarrier);    // threads are released together with main thread
+    for (uint32_t i = 0; i < config->threadCount; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    uint64_t producerElapsed = nowNs() - start;
+    loggerFlush();
+    uint64_t totalElapsed = nowNs() - start;
+    pthread_barrier_destroy(&startBarrier);
+
+    loggerStopAsync();
+    loggerUnsubscribeAll();
+    if (config->sink == BENCH_SINK_FILE) {
+        remove(fileName);
+    }
+
+    qsort(latencies, latencyCount, sizeof(uint64_t), compareLatency);
+    fprintf(resultOutput,
+            "{\"sink\":\"%s\",\"directory\":\"%s\",\"sync\":\"%s\",\"bufferSize\":%u,\"async\":%s,"
+            "\"threads\":%u,\"messagesPerThread\":%u,\"messageSize\":%u,\"filteredRatio\":%.3f,"
+            "\"seconds\":%.6f,\"drainSeconds\":%.6f,\"messagesPerSecond\":%.0f,"
+            "\"p50Ns\":%llu,\"p99Ns\":%llu,\"p999Ns\":%llu,\"maxNs\":%llu}\n",
+            SINK_NAMES[config->sink],
+            config->sink == BENCH_SINK_FILE ? config->directory : "",
+            config->sink == BENCH_SINK_FILE ? SYNC_MODE_NAMES[config->syncMode] : "",
+            config->sink == BENCH_SINK_FILE ? config->bufferSize : 0,
+            config->isAsync ? "true" : "false",
+            config->threadCount, config->messageCount, config->messageSize, config->filteredRatio,
+            producerElapsed / 1e9, totalElapsed / 1e9, latencyCount / (totalElapsed / 1e9),
+            (unsigned long long) percentile(latencies, latencyCount, 0.5),
+            (unsigned long long) percentile(latencies, latencyCount, 0.99),
+            (unsigned long long) percentile(latencies, latencyCount, 0.999),
+            (unsigned long long) latencies[latencyCount - 1]);
+    fflush(resultOutput);
+
+    free(message);
+    free(latencies);
+    return true;
+}
+
+static void printUsage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --sink=console|file|custom   benchmark single sink, default: all\n"
+            "  --dir=PATH                   directory for file sink, can be repeated, default: /dev/shm and .\n"
+            "  --threads=N                  maximum thread count, runs 1, 2, 4 ... N, default: 8\n"
+            "  --messages=N                 messages per thread, default: 10000\n"
+            "  --size=N                     single message size, default: 16, 128 and 512\n"
+            "  --filtered=RATIO             ratio of filtered messages 0..1, default: 0 and 0.9\n"
+            "  --sync=always|flush|periodic|none   file sync policy, default: always\n"
+            "  --buffer=BYTES               file write buffer size, default: stdio buffer\n"
+            "  --async                      run logger in asynchronous mode\n", name);
+}
+
+static bool parseSyncMode(const char *name, LogFileSyncMode *mode) {
+    for (uint8_t i = 0; i <= LOG_FILE_SYNC_NONE; i++) {
+        if (strcmp(name, SYNC_MODE_NAMES[i]) == 0) {
+            *mode = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option options[] = {
+            {"sink", required_argument, NULL, 's'},
+            {"dir", required_argument, NULL, 'd'},
+            {"threads", required_argument, NULL, 't'},
+            {"messages", required_argument, NULL, 'm'},
+            {"size", required_argument, NULL, 'z'},
+            {"filtered", required_argument, NULL, 'f'},
+            {"sync", required_argument, NULL, 'y'},
+            {"buffer", required_argument, NULL, 'b'},
+            {"async", no_argument, NULL, 'a'},
+            {"help", no_argument, NULL, 'h'},
+            {NULL, 0, NULL, 0}};
+
+    int sinkFilter = -1;
+    const char *directories[8] = {0};
+    uint8_t directoryCount = 0;
+    uint32_t maxThreads = 8;
+    BenchConfig base = {.messageCount = 10000, .syncMode = LOG_FILE_SYNC_ALWAYS};
+    uint32_t sizes[3] = {16, 128, 512};
+    uint8_t sizeCount = 3;
+    double filteredRatios[2] = {0.0, 0.9};
+    uint8_t filteredCount = 2;
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (option) {
+            case 's':
+                for (int i = 0; i <= BENCH_SINK_CUSTOM; i++) {
+                    if (strcmp(optarg, SINK_NAMES[i]) == 0) sinkFilter = i;
+                }
+                if (sinkFilter < 0) {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'd':
+                if (directoryCount < 8) directories[directoryCount++] = optarg;
+                break;
+            case 't':
+                maxThreads = (uint32_t) strtoul(optarg, NULL, 10);
+                maxThreads = maxThreads < 1 ? 1 : (maxThreads > BENCH_MAX_THREADS ? BENCH_MAX_THREADS : maxThreads);
+                break;
+            case 'm':
+                base.messageCount = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'z':
+                sizes[0] = (uint32_t) strtoul(optarg, NULL, 10);
+                sizeCount = 1;
+                break;
+            case 'f':
+                filteredRatios[0] = strtod(optarg, NULL);
+                filteredCount = 1;
+                break;
+            case 'y':
+                if (!parseSyncMode(optarg, &base.syncMode)) {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'b':
+                base.bufferSize = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'a':
+                base.isAsync = true;
+                break;
+            default:
+                printUsage(argv[0]);
+                return option == 'h' ? 0 : 1;
+        }
+    }
+
+    if (base.messageCount == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (directoryCount == 0) {
+        if (access("/dev/shm", W_OK) == 0) {
+            directories[directoryCount++] = "/dev/shm";     // tmpfs
+        }
+        directories[directoryCount++] = ".";
+    }
+
+    // keep results on original stdout, console sink writes to /dev/null
+    int resultDescriptor = dup(STDOUT_FILENO);
+    int nullDescriptor = open("/dev/null", O_WRONLY);
+    if (resultDescriptor < 0 || nullDescriptor < 0) {
+        perror("Failed to redirect stdout");
+        return 1;
+    }
+    resultOutput = fdopen(resultDescriptor, "w");
+    fflush(stdout);
+    dup2(nullDescriptor, STDOUT_FILENO);
+    close(nullDescriptor);
+
+    for (int sink = BENCH_SINK_CONSOLE; sink <= BENCH_SINK_CUSTOM; sink++) {
+        if (sinkFilter >= 0 && sink != sinkFilter) continue;
+        uint8_t sinkDirectoryCount = sink == BENCH_SINK_FILE ? directoryCount : 1;
+
+        for (uint8_t d = 0; d < sinkDirectoryCount; d++) {
+            for (uint32_t threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2) {
+                for (uint8_t z = 0; z < sizeCount; z++) {
+                    for (uint8_t f = 0; f < filteredCount; f++) {
+                        BenchConfig config = base;
+                        config.sink = sink;
+                        config.directory = directories[d];
+                        config.threadCount = threads;
+                        config.messageSize = sizes[z];
+                        config.filteredRatio = filteredRatios[f];
+                        if (!runBenchmark(&config)) {
+                            return 1;
+                        }
+                    }
+                }
+                if (threads == maxThreads) break;
+            }
+        }
+    }
+
+    fclose(resultOutput);
+    return 0;
+}
@@ -322,6 +322,315 @@ static MunitResult testFileLogger(const MunitParameter params[], void *testStrin
     return MUNIT_OK;
 }
 
+static MunitResult testBackgroundRotation(const MunitParameter params[], void *testString) {
+    loggerUnsubscribeAll();     // file logger test leaves its subscriber of the same file
+    LogFileConfig config = {.fileName = "test.log", .maxFileSize = 128, .maxBackupFiles = 3, .bufferSize = 256, .isBackgroundRotation = true};
+    LoggerEvent *event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+
+    for (int i = 1; i <= 14; i++) {
+        LOG_INFO("TEST", "test some message: [%d]", i);
+    }
+    loggerFlush();  // waits until rotated files are closed and moved to backups
+
+    char buffer[1025] = {0};
+    readFileContents("test.log", buffer);
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [13]"));
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [14]"));
+    assert_false(checkFileEntry(buffer, "TEST - test some message: [12]"));
+
+    char nameBuffer[64] = {0};
+    getBackupFileName(nameBuffer, NULL);
+    memset(buffer, 0, sizeof(buffer));
+    readFileContents(nameBuffer, buffer);
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [10]"));
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [12]"));
+    assert_false(checkFileEntry(buffer, "TEST - test some message: [9]"));
+    remove(nameBuffer);
+
+    getBackupFileName(nameBuffer, "2");
+    memset(buffer, 0, sizeof(buffer));
+    readFileContents(nameBuffer, buffer);
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [4]"));
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [6]"));
+    remove(nameBuffer);
+
+    getBackupFileName(nameBuffer, "3");
+    memset(buffer, 0, sizeof(buffer));
+    readFileContents(nameBuffer, buffer);
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [7]"));
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [9]"));
+    remove(nameBuffer);
+
+    getBackupFileName(nameBuffer, "1");     // the oldest backup is removed
+    memset(buffer, 0, sizeof(buffer));
+    readFileContents(nameBuffer, buffer);
+    assert_true(strlen(buffer) == 0);
+    loggerUnsubscribeAll();
+    remove("test.log");
+    return MUNIT_OK;
+}
+
+static MunitResult testStandbyFile(const MunitParameter params[], void *testString) {
+#if !defined(_WIN32) && !defined(_WIN64)
+    for (int mode = 0; mode < 2; mode++) {
+        LogFileConfig config = {.fileName = "test.log", .maxFileSize = 128, .maxBackupFiles = 3,
+                                .isStandbyFile = true, .isStandbyPreallocated = true, .isBackgroundRotation = mode == 1};
+        LoggerEvent *event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+        assert_true(event->isSubscribed);
+        assert_true(event->isBackgroundRotation);   // standby is prepared by rotation thread in any mode
+        assert_not_null(event->standbyOut);
+
+        for (int i = 1; i <= 14; i++) {
+            LOG_INFO("TEST", "test some message: [%d]", i);
+        }
+        loggerFlush();
+
+        char buffer[1025] = {0};
+        readFileContents("test.log", buffer);
+        assert_true(checkFileEntry(buffer, "TEST - test some message: [13]"));
+        assert_true(checkFileEntry(buffer, "TEST - test some message: [14]"));
+        assert_false(checkFileEntry(buffer, "TEST - test some message: [12]"));
+
+        char nameBuffer[64] = {0};
+        getBackupFileName(nameBuffer, NULL);
+        memset(buffer, 0, sizeof(buffer));
+        readFileContents(nameBuffer, buffer);
+        assert_true(checkFileEntry(buffer, "TEST - test some message: [10]"));
+        assert_true(checkFileEntry(buffer, "TEST - test some message: [12]"));
+        remove(nameBuffer);
+        getBackupFileName(nameBuffer, "2");
+        remove(nameBuffer);
+        getBackupFileName(nameBuffer, "3");
+        remove(nameBuffer);
+
+        FILE *standbyFile = fopen("test.log.standby", "r");    // next standby is created after rotation
+        assert_not_null(standbyFile);
+        fclose(standbyFile);
+        loggerUnsubscribeAll();
+        assert_null(fopen("test.log.standby", "r"));   // unused standby is removed
+        remove("test.log");
+    }
+#endif
+    return MUNIT_OK;
+}
+
+static void sleepMilliseconds(uint32_t milliseconds) {
+#if defined(_WIN32) || defined(_WIN64)
+    Sleep(milliseconds);
+#else
+    usleep(milliseconds * 1000);
+#endif
+}
+
+static MunitResult testTimeRotation(const MunitParameter params[], void *testString) {
+    LogFileConfig config = {.fileName = "test.log", .maxFileSize = 1024 * 1024, .maxBackupFiles = 3,
+                            .rotationPeriod = LOG_ROTATION_INTERVAL, .rotationIntervalMs = 100};
+    LoggerEvent *event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+
+    LOG_INFO("TEST", "test some message: [%d]", 1);
+    LOG_INFO("TEST", "test some message: [%d]", 2);
+    sleepMilliseconds(150);
+    LOG_INFO("TEST", "test some message: [%d]", 3);   // rotates before write, file is far below maxFileSize
+
+    char buffer[1025] = {0};
+    readFileContents("test.log", buffer);
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [3]"));
+    assert_false(checkFileEntry(buffer, "TEST - test some message: [2]"));
+
+    char nameBuffer[64] = {0};
+    getBackupFileName(nameBuffer, NULL);
+    memset(buffer, 0, sizeof(buffer));
+    readFileContents(nameBuffer, buffer);
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [1]"));
+    assert_true(checkFileEntry(buffer, "TEST - test some message: [2]"));
+    assert_false(checkFileEntry(buffer, "TEST - test some message: [3]"));
+    remove(nameBuffer);
+    loggerUnsubscribeAll();
+    remove("test.log");
+
+    config.rotationPeriod = LOG_ROTATION_HOURLY;
+    event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+    assert_true(event->rotationDeadline > 0);
+    assert_true(event->rotationDeadline - event->lastSyncTime <= 3600 * 1000);   // deadline at the next hour
+    loggerUnsubscribeAll();
+    remove("test.log");
+    return MUNIT_OK;
+}
+
+static size_t readWholeFile(const char *name, char *buffer, size_t size) {
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) return 0;
+    size_t length = fread(buffer, sizeof(char), size - 1, file);
+    fclose(file);
+    buffer[length] = '\0';
+    return length;
+}
+
+static bool isFileExist(const char *name) {
+    FILE *file = fopen(name, "r");
+    if (file == NULL) {
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+static MunitResult testExistingBackupFiles(const MunitParameter params[], void *testString) {
+    const char *oldBackups[] = {"test_2020-01-01.log", "test_2020-01-02.log", "test_2020-01-03.log", "test_2020-01-04.log.2", "test_2020-01-05_10.log"};
+    for (uint8_t i = 0; i < 5; i++) {
+        FILE *file = fopen(oldBackups[i], "w");
+        fputs("old backup\n", file);
+        fclose(file);
+        sleepMilliseconds(20);  // files are ordered by modification time
+    }
+    FILE *file = fopen("test_other.log", "w");   // not a backup of "test.log"
+    fclose(file);
+
+    LogFileConfig config = {.fileName = "test.log", .maxFileSize = 1024 * 1024, .maxBackupFiles = 3,
+                            .rotationPeriod = LOG_ROTATION_INTERVAL, .rotationIntervalMs = 100};
+    LoggerEvent *event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+    assert_false(isFileExist(oldBackups[0]));    // oldest ones are over maxBackupFiles
+    assert_false(isFileExist(oldBackups[1]));
+    assert_true(isFileExist(oldBackups[2]));
+    assert_true(isFileExist(oldBackups[3]));
+    assert_true(isFileExist(oldBackups[4]));
+    assert_true(isFileExist("test_other.log"));
+    assert_string_equal(event->backupFiles[0].name, oldBackups[2]);
+    assert_string_equal(event->backupFiles[2].name, oldBackups[4]);
+
+    LOG_INFO("TEST", "test some message: [%d]", 1);
+    sleepMilliseconds(150);
+    LOG_INFO("TEST", "test some message: [%d]", 2);    // rotation replaces the oldest loaded backup
+    assert_false(isFileExist(oldBackups[2]));
+    assert_true(isFileExist(oldBackups[3]));
+    assert_true(isFileExist(oldBackups[4]));
+
+    char nameBuffer[64] = {0};
+    getBackupFileName(nameBuffer, NULL);
+    assert_true(isFileExist(nameBuffer));
+    loggerUnsubscribeAll();
+    remove(nameBuffer);
+    remove(oldBackups[3]);
+    remove(oldBackups[4]);
+    remove("test_other.log");
+    remove("test.log");
+
+    char suffixedBackups[3][64];    // backups of the same day from previous run
+    getBackupFileName(suffixedBackups[0], NULL);
+    getBackupFileName(suffixedBackups[1], "2");
+    getBackupFileName(suffixedBackups[2], "3");
+    for (uint8_t i = 0; i < 3; i++) {
+        file = fopen(suffixedBackups[i], "w");
+        fputs("old backup\n", file);
+        fclose(file);
+        sleepMilliseconds(20);
+    }
+
+    config = (LogFileConfig) {.fileName = "test.log", .maxFileSize = 16, .maxBackupFiles = 4};
+    event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+    for (uint8_t i = 0; i < 4; i++) {
+        LOG_INFO("TEST", "test some message: [%d]", i);   // each message after the first one rotates
+    }
+
+    uint64_t backupSize = 0;
+    uint64_t fileSize = 0;
+    char contents[1024];
+    for (uint8_t i = 0; i < event->maxBackupFiles; i++) {
+        const char *name = event->backupFiles[i].name;
+        assert_true(isFileExist(name));
+        fileSize += readWholeFile(name, contents, sizeof(contents));
+        for (uint8_t j = i + 1; j < event->maxBackupFiles; j++) {
+            assert_string_not_equal(name, event->backupFiles[j].name);  // tracked backup is never reused by other one
+        }
+        backupSize += event->backupFiles[i].size;
+    }
+    assert_true(backupSize == event->backupSize);
+    assert_true(fileSize == event->backupSize);     // each file is counted once
+    for (uint8_t i = 0; i < event->maxBackupFiles; i++) {
+        remove(event->backupFiles[i].name);
+    }
+    loggerUnsubscribeAll();
+    remove("test.log");
+
+    file = fopen("test.log.7.rotated", "w");    // left by process stopped before rotation thread archived it
+    fputs("rotated\n", file);
+    fclose(file);
+    config = (LogFileConfig) {.fileName = "test.log", .maxFileSize = 1024, .maxBackupFiles = 2};
+    event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+    assert_false(isFileExist("test.log.7.rotated"));
+    getBackupFileName(suffixedBackups[0], NULL);
+    assert_string_equal(event->backupFiles[1].name, suffixedBackups[0]);
+    assert_true(event->backupSize == strlen("rotated\n"));
+    char buffer[1025] = {0};
+    readFileContents(suffixedBackups[0], buffer);
+    assert_true(checkFileEntry(buffer, "rotated"));
+    loggerUnsubscribeAll();
+    remove(suffixedBackups[0]);
+    remove("test.log");
+    return MUNIT_OK;
+}
+
+static MunitResult testBackupRetention(const MunitParameter params[], void *testString) {
+    LogFileConfig config = {.fileName = "test.log", .maxFileSize = 128, .maxBackupFiles = 5, .maxTotalSize = 512};
+    LoggerEvent *event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+
+    for (uint8_t i = 0; i < 40; i++) {
+        LOG_INFO("TEST", "test some message: [%d]", i);
+    }
+
+    uint64_t backupSize = 0;
+    uint8_t backupCount = 0;
+    for (uint8_t i = 0; i < event->maxBackupFiles; i++) {
+        if (event->backupFiles[i].name[0] != '\0') {
+            assert_true(isFileExist(event->backupFiles[i].name));
+            backupSize += event->backupFiles[i].size;
+            backupCount++;
+        }
+    }
+    assert_true(backupCount > 0 && backupCount < event->maxBackupFiles);    // total size is reached before backup count
+    assert_true(event->backupSize == backupSize);
+    assert_true(event->backupSize + event->file->maxSize <= event->maxTotalSize);
+    assert_true(event->backupFiles[event->maxBackupFiles - 1].name[0] != '\0');    // the newest backup is kept
+    loggerUnsubscribeAll();
+
+    char nameBuffer[64] = {0};  // backups of the same day: name, name.2, ... name.5
+    getBackupFileName(nameBuffer, NULL);
+    remove(nameBuffer);
+    for (uint8_t i = 2; i <= 5; i++) {
+        char postfix[4];
+        snprintf(postfix, sizeof(postfix), "%d", i);
+        getBackupFileName(nameBuffer, postfix);
+        remove(nameBuffer);
+    }
+    remove("test.log");
+
+    config = (LogFileConfig) {.fileName = "test.log", .maxFileSize = 16, .maxBackupFiles = 3, .maxBackupAgeSec = 1};
+    event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+    LOG_INFO("TEST", "test some message: [%d]", 1);
+    LOG_INFO("TEST", "test some message: [%d]", 2);   // first backup
+    assert_true(event->backupFiles[2].name[0] != '\0');
+    char firstBackup[64];
+    strcpy(firstBackup, event->backupFiles[2].name);
+
+    sleepMilliseconds(2100);
+    LOG_INFO("TEST", "test some message: [%d]", 3);   // second backup, the first one is expired
+    assert_false(isFileExist(firstBackup));
+    assert_true(event->backupFiles[1].name[0] == '\0');
+    assert_true(isFileExist(event->backupFiles[2].name));
+    remove(event->backupFiles[2].name);
+    loggerUnsubscribeAll();
+    remove("test.log");
+    return MUNIT_OK;
+}
+
 static MunitResult testLogToFileOverflow(const MunitParameter params[], void *testString) {
     // check for overflow
    LoggerEvent *event = subscribeFileLogger(LOG_LEVEL_TRACE, "test_2.log", 128, 0);
@@ -366,6 +675,144 @@ static MunitResult testLogToFileOverflow(const MunitParameter params[], void *te
     return MUNIT_OK;
 }
 
+static MunitResult testFileSyncPolicy(const MunitParameter params[], void *testString) {
+    LogFileConfig config = {
+            .fileName = "test_sync.log",
+            .maxFileSize = 4096,
+            .sync = {.mode = LOG_FILE_SYNC_NONE, .level = LOG_LEVEL_ERROR}
+    };
+    LoggerEvent *event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+
+    LOG_INFO("TEST", "test some message: [%d]", 1);
+    char buffer[1024] = {0};
+    readFileContents("test_sync.log", buffer);
+    assert_size(strlen(buffer), ==, 0);     // still in file buffer
+
+    LOG_ERROR("TEST", "test some message: [%d]", 2);   // level above policy threshold is synced immediately
+    readFileContents("test_sync.log", buffer);
+    assert_true(checkFileEntry(buffer, " | INFO | TEST - test some message: [1]\n"));
+    assert_true(checkFileEntry(buffer, " | ERROR | TEST - test some message: [2]\n"));
+    loggerUnsubscribeAll();
+    remove("test_sync.log");
+
+    config.sync = (LogFileSyncPolicy) {.mode = LOG_FILE_SYNC_PERIODIC, .bytes = 100};
+    event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+
+    LOG_INFO("TEST", "test some message: [%d]", 3);
+    memset(buffer, 0, 1024);
+    readFileContents("test_sync.log", buffer);
+    assert_size(strlen(buffer), ==, 0);
+
+    LOG_INFO("TEST", "test some message: [%d]", 4);    // byte limit reached
+    readFileContents("test_sync.log", buffer);
+    assert_true(checkFileEntry(buffer, " | INFO | TEST - test some message: [3]\n"));
+    assert_true(checkFileEntry(buffer, " | INFO | TEST - test some message: [4]\n"));
+    loggerUnsubscribeAll();
+    remove("test_sync.log");
+
+    assert_false(subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, NULL)->isSubscribed);
+    return MUNIT_OK;
+}
+
+static MunitResult testFileWriteBuffer(const MunitParameter params[], void *testString) {
+    LogFileConfig config = {
+            .fileName = "test_buffer.log",
+            .maxFileSize = 4096,
+            .sync = {.mode = LOG_FILE_SYNC_NONE},
+            .bufferSize = 256
+    };
+    LoggerEvent *event = subscribeFileLoggerWithConfig(LOG_LEVEL_TRACE, &config);
+    assert_true(event->isSubscribed);
+
+    LOG_INFO("TEST", "test some message: [%d]", 1);
+    LOG_INFO("TEST", "test some message: [%d]", 2);
+    char buffer[1024] = {0};
+    readFileContents("test_buffer.log", buffer);
+    assert_size(strlen(buffer), ==, 0);     // combined in write buffer
+
+    for (int i = 3; i <= 6; i++) {     // buffer overflow writes combined messages
+        LOG_INFO("TEST", "test some message: [%d]", i);
+    }
+    readFileContents("test_buffer.log", buffer);
+    assert_true(checkFileEntry(buffer, " | INFO | TEST - test some message: [1]\n"));
+    assert_false(checkFileEntry(buffer, " | INFO | TEST - test some message: [6]\n"));
+
+    loggerFlush();
+    readFileContents("test_buffer.log", buffer);
+    assert_true(checkFileEntry(buffer, " | INFO | TEST - test some message: [6]\n"));
+
+    LOG_INFO("TEST", "test some message: [%d]", 7);
+    loggerUnsubscribe(event);   // buffer is written out on unsubscribe
+    readFileContents("test_buffer.log", buffer);
+    assert_true(checkFileEntry(buffer, " | INFO | TEST - test some message: [7]\n"));
+    remove("test_buffer.log");
+
+    return MUNIT_OK;
+}
+
+static MunitResult testBinaryFileLogger(const MunitParameter params[], void *testString) {
+    remove("test_text.log");
+    remove("test_binary.log");
+    LogFileConfig textConfig = {.fileName = "test_text.log", .sync = {.mode = LOG_FILE_SYNC_NONE}};
+    LogFileConfig binaryConfig = {.fileName = "test_binary.log", .sync = {.mode = LOG_FILE_SYNC_NONE}};
+    assert_true(subscribeFileLoggerWithConfig(LOG_LEVEL_DEBUG, &textConfig)->isSubscribed);
+    LoggerEvent *binaryEvent = subscribeBinaryFileLogger(LOG_LEVEL_DEBUG, &binaryConfig);
+    assert_true(binaryEvent->isSubscribed);
+
+    loggerSetTimestampPrecision(LOG_TIMESTAMP_MICROSECONDS);
+    for (int i = 0; i < 50; i++) {
+        LOG_INFO("BINARY", "Request: [%s], status: [%d], took: [%.3f] ms", "/api/users", 200 + i, i * 1.5);
+        LOG_DEBUG("DB", "Query rows: [%zu], cache: [%3d%%]", (size_t) i * 10, i);
+    }
+    LOG_TRACE("BINARY", "filtered message: [%d]", 1);
+    logMessage("PLAIN", LOG_LEVEL_WARN, "Message without call site: [%ld]", 42L);
+    const char *format = "Not literal format: [%s]";
+    LOG_ERROR("BINARY", format, (char *) NULL);
+    loggerUnsubscribeAll();
+    loggerSetTimestampPrecision(LOG_TIMESTAMP_SECONDS);
+
+    FILE *input = fopen("test_binary.log", "rb");
+    FILE *output = fopen("test_decoded.log", "w");
+    assert_true(loggerDecodeBinaryFile(input, output));
+    fclose(input);
+    fclose(output);
+
+    static char text[16384];
+    static char decoded[16384];
+    size_t textLength = readWholeFile("test_text.log", text, sizeof(text));
+    size_t decodedLength = readWholeFile("test_decoded.log", decoded, sizeof(decoded));
+    assert_size(textLength, >, 0);
+    assert_size(textLength, ==, decodedLength);
+    assert_string_equal(text, decoded);     // same layout as text logger
+
+    size_t binaryLength = readWholeFile("test_binary.log", decoded, sizeof(decoded));
+    assert_size(binaryLength * 2, <, textLength);
+    remove("test_text.log");
+    remove("test_binary.log");
+
+    assert_true(subscribeBinaryFileLogger(LOG_LEVEL_DEBUG, &binaryConfig)->isSubscribed);
+    LOG_INFO("BINARY", "Name: [%s]", "abc");    // record ends with string length and "abc"
+    loggerUnsubscribeAll();
+    binaryLength = readWholeFile("test_binary.log", decoded, sizeof(decoded));
+    uint16_t corruptedLength = 200;     // string longer than the record
+    memcpy(decoded + binaryLength - 6, &corruptedLength, sizeof(corruptedLength));
+    FILE *corrupted = fopen("test_binary.log", "wb");
+    fwrite(decoded, 1, binaryLength, corrupted);
+    fclose(corrupted);
+
+    input = fopen("test_binary.log", "rb");
+    output = fopen("test_decoded.log", "w");
+    assert_false(loggerDecodeBinaryFile(input, output));
+    fclose(input);
+    fclose(output);
+    remove("test_binary.log");
+    remove("test_decoded.log");
+
+    return MUNIT_OK;
+}
+
 static void customLoggerCallbackFun(LogLevel severity, const char *message, uint32_t length) {
     assert_int(LOG_LEVEL_INFO, ==, severity);
     assert_true(checkFileEntry(message, " | INFO | TEST - test some message: [1]\n"));
@@ -433,14 +880,572 @@ static MunitResult testOverflowLogger(const MunitParameter params[], void *testS
     return MUNIT_OK;
 }
 
+static char sharedMessageBuffer[2][256] = {0};
+
+static void firstSharedCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    strncpy(sharedMessageBuffer[0], message, length);
+}
+
+static void secondSharedCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    strncpy(sharedMessageBuffer[1], message, length);
+}
+
+static MunitResult testMultipleSubscribers(const MunitParameter params[], void *testString) {
+    memset(sharedMessageBuffer, 0, sizeof(sharedMessageBuffer));
+    assert_true(subscribeCustomLogger(LOG_LEVEL_INFO, firstSharedCallbackFun)->isSubscribed);
+    assert_true(subscribeCustomLogger(LOG_LEVEL_TRACE, secondSharedCallbackFun)->isSubscribed);
+    assert_true(subscribeFileLogger(LOG_LEVEL_INFO, "test_shared.log", 1024, 0)->isSubscribed);
+
+    LOG_INFO("TEST", "shared message: [%d]", 1);
+    loggerUnsubscribeAll();
+
+    char buffer[1024] = {0};
+    readFileContents("test_shared.log", buffer);
+    assert_true(checkFileEntry(sharedMessageBuffer[0], " | INFO | TEST - shared message: [1]\n"));
+    assert_string_equal(sharedMessageBuffer[0], sharedMessageBuffer[1]);
+    assert_string_equal(sharedMessageBuffer[0], buffer);
+    remove("test_shared.log");
+
+    return MUNIT_OK;
+}
+
+static char precisionMessageBuffer[256] = {0};
+
+static void precisionCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    strncpy(precisionMessageBuffer, message, length);
+}
+
+static bool checkFractionDigits(const char *message, uint8_t digits) {  // "dd MMM yyyy hh:mm:ss.fraction | "
+    if (message[20] != '.') return false;
+    for (uint8_t i = 0; i < digits; i++) {
+        if (!isdigit((int) message[21 + i])) return false;
+    }
+    return strncmp(message + 21 + digits, " | ", 3) == 0;
+}
+
+static MunitResult testTimestampPrecision(const MunitParameter params[], void *testString) {
+    assert_true(subscribeCustomLogger(LOG_LEVEL_INFO, precisionCallbackFun)->isSubscribed);
+
+    time_t logTime = time(NULL);
+    char expectedTimestamp[32] = {0};
+    strftime(expectedTimestamp, sizeof(expectedTimestamp), "%d %b %Y %H:%M:%S | ", localtime(&logTime));
+    LOG_INFO("TEST", "seconds");
+    assert_true(strncmp(precisionMessageBuffer, expectedTimestamp, 14) == 0);   // up to minutes
+    assert_true(checkFileEntry(precisionMessageBuffer, " | INFO | TEST - seconds\n"));
+    assert_true(strncmp(precisionMessageBuffer + 20, " | ", 3) == 0);
+
+    loggerSetTimestampPrecision(LOG_TIMESTAMP_MILLISECONDS);
+    LOG_INFO("TEST", "milliseconds");
+    assert_true(checkFractionDigits(precisionMessageBuffer, 3));
+
+    loggerSetTimestampPrecision(LOG_TIMESTAMP_MICROSECONDS);
+    LOG_INFO("TEST", "microseconds");
+    assert_true(checkFractionDigits(precisionMessageBuffer, 6));
+
+    loggerSetTimestampPrecision(LOG_TIMESTAMP_NANOSECONDS);
+    LOG_INFO("TEST", "nanoseconds");
+    assert_true(checkFractionDigits(precisionMessageBuffer, 9));
+    assert_true(checkFileEntry(precisionMessageBuffer, " | INFO | TEST - nanoseconds\n"));
+
+    loggerSetTimestampPrecision(LOG_TIMESTAMP_SECONDS);
+    loggerUnsubscribeAll();
+    return MUNIT_OK;
+}
+
+static uint32_t compileLevelMessageCount = 0;
+
+static void compileLevelCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    compileLevelMessageCount++;
+}
+
+#undef LOGGER_COMPILE_LEVEL
+#define LOGGER_COMPILE_LEVEL LOG_LEVEL_INFO
+
+static MunitResult testCompileLevel(const MunitParameter params[], void *testString) {
+    compileLevelMessageCount = 0;
+    assert_true(subscribeCustomLogger(LOG_LEVEL_TRACE, compileLevelCallbackFun)->isSubscribed);
+
+    uint32_t argumentEvaluationCount = 0;
+    LOG_TRACE("TEST", "stripped: [%u]", argumentEvaluationCount++);
+    LOG_DEBUG("TEST", "stripped: [%u]", argumentEvaluationCount++);
+    assert_uint32(argumentEvaluationCount, ==, 0);
+    assert_uint32(compileLevelMessageCount, ==, 0);
+
+    LOG_INFO("TEST", "compiled: [%u]", argumentEvaluationCount++);
+    LOG_FATAL("TEST", "compiled: [%u]", argumentEvaluationCount++);
+    assert_uint32(argumentEvaluationCount, ==, 2);
+    assert_uint32(compileLevelMessageCount, ==, 2);
+    loggerUnsubscribeAll();
+
+    return MUNIT_OK;
+}
+
+#undef LOGGER_COMPILE_LEVEL
+#define LOGGER_COMPILE_LEVEL LOG_LEVEL_TRACE
+
+static MunitResult testThresholdLevel(const MunitParameter params[], void *testString) {
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_FATAL));    // no subscribers
+
+    LoggerEvent *event = subscribeCustomLogger(LOG_LEVEL_INFO, compileLevelCallbackFun);
+    LoggerEvent *consoleEvent = subscribeConsoleLogger(LOG_LEVEL_ERROR);
+    assert_true(event->isSubscribed);
+    assert_true(consoleEvent->isSubscribed);
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_DEBUG));
+    assert_true(loggerIsLevelEnabled(LOG_LEVEL_INFO));
+
+    loggerSetLevel(event, LOG_LEVEL_DEBUG);
+    assert_true(loggerIsLevelEnabled(LOG_LEVEL_DEBUG));
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_TRACE));
+
+    loggerUnsubscribe(event);
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_WARN));
+    assert_true(loggerIsLevelEnabled(LOG_LEVEL_ERROR));
+
+    loggerUnsubscribeAll();
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_FATAL));
+    return MUNIT_OK;
+}
+
+static uint32_t tagLevelMessageCount = 0;
+
+static void tagLevelCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    assert_true(checkFileEntry(message, " | NET - ") || checkFileEntry(message, " | INFO | DB - "));
+    tagLevelMessageCount++;
+}
+
+static MunitResult testTagLevel(const MunitParameter params[], void *testString) {
+    tagLevelMessageCount = 0;
+    assert_true(subscribeCustomLogger(LOG_LEVEL_TRACE, tagLevelCallbackFun)->isSubscribed);
+    loggerSetDefaultTagLevel(LOG_LEVEL_INFO);
+    loggerSetTagLevel("NET", LOG_LEVEL_DEBUG);
+    assert_true(loggerIsLevelEnabled(LOG_LEVEL_DEBUG));
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_TRACE));    // no tag accepts trace messages
+
+    const char *tags[] = {"NET", "DB", "NET", "DB"};
+    for (uint32_t i = 0; i < 4; i++) {
+        LOG_DEBUG(tags[i], "debug message: [%u]", i);   // not constant tag is checked by tag table
+        LOG_INFO(tags[i], "info message: [%u]", i);
+    }
+    logMessage("DB", LOG_LEVEL_DEBUG, "filtered message: [%d]", 1);
+    logMessage("NET", LOG_LEVEL_DEBUG, "debug message: [%d]", 1);
+    assert_uint32(tagLevelMessageCount, ==, 7);
+
+    tagLevelMessageCount = 0;
+    loggerClearTagLevel("NET");
+    LOG_DEBUG("NET", "filtered message: [%d]", 2);
+    LOG_INFO("NET", "info message: [%d]", 2);
+    assert_uint32(tagLevelMessageCount, ==, 1);
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_DEBUG));
+
+    loggerSetDefaultTagLevel(LOG_LEVEL_UNKNOWN);
+    LOG_DEBUG("NET", "debug message: [%d]", 3);
+    assert_uint32(tagLevelMessageCount, ==, 2);
+    loggerUnsubscribeAll();
+
+    return MUNIT_OK;
+}
+
+static uint32_t tagHierarchyMessageCount = 0;
+
+static void tagHierarchyCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    assert_false(checkFileEntry(message, "filtered"));
+    tagHierarchyMessageCount++;
+}
+
+static MunitResult testTagHierarchy(const MunitParameter params[], void *testString) {
+    tagHierarchyMessageCount = 0;
+    assert_true(subscribeCustomLogger(LOG_LEVEL_TRACE, tagHierarchyCallbackFun)->isSubscribed);
+    loggerSetDefaultTagLevel(LOG_LEVEL_INFO);
+    loggerSetTagLevel("net", LOG_LEVEL_WARN);
+    loggerSetTagLevel("net.http", LOG_LEVEL_DEBUG);
+
+    LOG_DEBUG("net.http.client", "debug message: [%d]", 1);     // the most specific rule wins
+    LOG_DEBUG("net.http", "debug message: [%d]", 2);
+    LOG_INFO("net.tcp", "filtered message: [%d]", 3);
+    LOG_WARN("net.tcp", "warn message: [%d]", 4);
+    LOG_INFO("net", "filtered message: [%d]", 5);
+    LOG_INFO("network", "info message: [%d]", 6);  // not a child of "net"
+    LOG_DEBUG("db.pool", "filtered message: [%d]", 7);
+    assert_uint32(tagHierarchyMessageCount, ==, 4);
+
+    loggerClearTagLevel("net.http");    // rule of parent is applied to already cached tags
+    LOG_DEBUG("net.http.client", "filtered message: [%d]", 8);
+    LOG_WARN("net.http.client", "warn message: [%d]", 9);
+    assert_uint32(tagHierarchyMessageCount, ==, 5);
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_DEBUG));
+
+    loggerClearTagLevel("net");
+    loggerSetDefaultTagLevel(LOG_LEVEL_UNKNOWN);
+    loggerUnsubscribeAll();
+    return MUNIT_OK;
+}
+
+static uint32_t auditMessageCount = 0;
+static uint32_t appMessageCount = 0;
+
+static void auditCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    assert_true(checkFileEntry(message, "| AUDIT -"));
+    auditMessageCount++;
+}
+
+static void appCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    assert_false(checkFileEntry(message, "| AUDIT -"));
+    assert_false(checkFileEntry(message, "| NOISE -"));
+    appMessageCount++;
+}
+
+static MunitResult testTagFilter(const MunitParameter params[], void *testString) {
+    auditMessageCount = 0;
+    appMessageCount = 0;
+    LoggerEvent *auditLogger = subscribeCustomLogger(LOG_LEVEL_INFO, auditCallbackFun);
+    LoggerEvent *appLogger = subscribeCustomLogger(LOG_LEVEL_INFO, appCallbackFun);
+    assert_true(auditLogger->isSubscribed && appLogger->isSubscribed);
+    const char *auditTags[] = {"AUDIT"};
+    const char *excludedTags[] = {"AUDIT", "NOISE"};
+    loggerAllowTags(auditLogger, auditTags, 1);
+    loggerDenyTags(appLogger, excludedTags, 2);
+
+    LOG_INFO("AUDIT", "User [%s] logged in", "admin");
+    LOG_INFO("MAIN", "Application message: [%d]", 1);
+    LOG_WARN("NOISE", "Filtered by both subscribers: [%d]", 2);
+    logMessage(NULL, LOG_LEVEL_INFO, "Message without tag: [%d]", 3);
+    LOG_INFO("AUDITOR", "Not the same tag: [%d]", 4);
+    assert_uint32(auditMessageCount, ==, 1);
+    assert_uint32(appMessageCount, ==, 3);
+
+    loggerUnsubscribe(appLogger);
+    loggerAllowTags(auditLogger, NULL, 0);  // empty set removes filter
+    LOG_INFO("AUDIT", "User [%s] logged out", "admin");
+    assert_uint32(auditMessageCount, ==, 2);
+    assert_uint32(appMessageCount, ==, 3);
+    loggerUnsubscribeAll();
+    return MUNIT_OK;
+}
+
+static uint32_t rateLimitMessageCount = 0;
+
+static void rateLimitCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    rateLimitMessageCount++;
+}
+
+static MunitResult testRateLimitedLogging(const MunitParameter params[], void *testString) {
+    LoggerEvent *subscriber = subscribeCustomLogger(LOG_LEVEL_INFO, rateLimitCallbackFun);
+    assert_true(subscriber->isSubscribed);
+
+    rateLimitMessageCount = 0;
+    for (int i = 0; i < 100; i++) {
+        LOG_WARN_EVERY_N("TEST", 10, "Every 10th message: [%d]", i);
+        LOG_DEBUG_EVERY_N("TEST", 10, "Disabled message: [%d]", i);
+    }
+    assert_uint32(rateLimitMessageCount, ==, 10);
+
+    rateLimitMessageCount = 0;
+    for (int i = 0; i < 100; i++) {
+        LOG_ERROR_FIRST_N("TEST", 5, "First 5 messages: [%d]", i);
+    }
+    assert_uint32(rateLimitMessageCount, ==, 5);
+
+    rateLimitMessageCount = 0;
+    for (int i = 0; i < 100; i++) {
+        LOG_INFO_EVERY_MS("TEST", 60 * 1000, "Once per minute: [%d]", i);
+    }
+    assert_uint32(rateLimitMessageCount, ==, 1);
+
+    rateLimitMessageCount = 0;
+    for (int i = 0; i < 1000; i++) {
+        LOG_INFO_SAMPLED("TEST", 0.0, "Never sampled: [%d]", i);
+        LOG_INFO_SAMPLED("TEST", 1.0, "Always sampled: [%d]", i);
+    }
+    assert_uint32(rateLimitMessageCount, ==, 1000);
+
+    rateLimitMessageCount = 0;
+    for (int i = 0; i < 10000; i++) {
+        LOG_INFO_SAMPLED("TEST", 0.5, "Half sampled: [%d]", i);
+    }
+    assert_uint32(rateLimitMessageCount, >, 4000);
+    assert_uint32(rateLimitMessageCount, <, 6000);
+
+    loggerUnsubscribeAll();
+    return MUNIT_OK;
+}
+
+static uint32_t deduplicationMessageCount = 0;
+static char deduplicationLastMessage[LOGGER_BUFFER_SIZE + 1];
+
+static void deduplicationCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    memcpy(deduplicationLastMessage, message, length + 1);
+    deduplicationMessageCount++;
+}
+
+static MunitResult testDeduplication(const MunitParameter params[], void *testString) {
+    deduplicationMessageCount = 0;
+    LoggerEvent *subscriber = subscribeCustomLogger(LOG_LEVEL_INFO, deduplicationCallbackFun);
+    assert_true(subscriber->isSubscribed);
+    loggerEnableDeduplication(subscriber, 60 * 1000);
+
+    for (int i = 0; i < 100; i++) {
+        LOG_ERROR("NET", "Connection refused: [%s]", "localhost");
+    }
+    assert_uint32(deduplicationMessageCount, ==, 1);
+
+    LOG_ERROR("NET", "Connection refused: [%s]", "remote");     // streak ended
+    assert_uint32(deduplicationMessageCount, ==, 3);
+    assert_true(checkFileEntry(deduplicationLastMessage, "| ERROR | NET - Connection refused: [remote]\n"));
+
+    LOG_ERROR("NET", "Connection refused: [%s]", "remote");
+    LOG_WARN("NET", "Connection refused: [%s]", "remote");  // different level is not a repeat
+    assert_uint32(deduplicationMessageCount, ==, 5);
+    assert_true(checkFileEntry(deduplicationLastMessage, "| WARN | NET - Connection refused: [remote]\n"));
+
+    LOG_WARN("NET", "Connection refused: [%s]", "remote");
+    LOG_WARN("NET", "Connection refused: [%s]", "remote");
+    loggerFlush();  // pending summary is written out on flush
+    assert_uint32(deduplicationMessageCount, ==, 6);
+    assert_true(checkFileEntry(deduplicationLastMessage, "| WARN | NET - Last message repeated [2] times\n"));
+
+    loggerEnableDeduplication(subscriber, 0);
+    LOG_WARN("NET", "Connection refused: [%s]", "remote");
+    LOG_WARN("NET", "Connection refused: [%s]", "remote");
+    assert_uint32(deduplicationMessageCount, ==, 8);
+    loggerUnsubscribeAll();
+    return MUNIT_OK;
+}
+
+#define REGISTRY_SUBSCRIBER_COUNT (LOGGER_MAX_SUBSCRIBERS * 4 + 1)
+
+static uint32_t registryMessageCount = 0;
+
+static void registryCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    registryMessageCount++;
+}
+
+static MunitResult testSubscriberRegistry(const MunitParameter params[], void *testString) {
+    registryMessageCount = 0;
+    LoggerEvent *events[REGISTRY_SUBSCRIBER_COUNT];
+    for (uint32_t i = 0; i < REGISTRY_SUBSCRIBER_COUNT; i++) {  // registry grows beyond initial capacity
+        events[i] = subscribeCustomLogger(i % 2 == 0 ? LOG_LEVEL_INFO : LOG_LEVEL_ERROR, registryCallbackFun);
+        assert_true(events[i]->isSubscribed);
+    }
+    LOG_INFO("REGISTRY", "test some message: [%d]", 1);
+    assert_uint32(registryMessageCount, ==, REGISTRY_SUBSCRIBER_COUNT / 2 + 1);
+
+    for (uint32_t i = 0; i < REGISTRY_SUBSCRIBER_COUNT; i += 2) {   // remove every subscriber with INFO level
+        loggerUnsubscribe(events[i]);
+    }
+    for (uint32_t i = 1; i < REGISTRY_SUBSCRIBER_COUNT; i += 2) {   // remaining handles are not moved
+        assert_true(events[i]->isSubscribed);
+        assert_int(events[i]->level, ==, LOG_LEVEL_ERROR);
+    }
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_WARN));
+    assert_false(events[0]->isSubscribed);
+    loggerUnsubscribe(events[0]);   // stale handle is ignored
+    loggerEnableDeduplication(events[0], 100);
+    assert_null(events[0]->deduplicator);
+
+    registryMessageCount = 0;
+    LOG_ERROR("REGISTRY", "test some message: [%d]", 2);
+    assert_uint32(registryMessageCount, ==, REGISTRY_SUBSCRIBER_COUNT / 2);
+
+    registryMessageCount = 0;
+    loggerSetLevel(events[1], LOG_LEVEL_DEBUG);     // dispatch lists are rebuilt on level change
+    LOG_DEBUG("REGISTRY", "test some message: [%d]", 3);
+    LOG_TRACE("REGISTRY", "test some message: [%d]", 4);
+    assert_uint32(registryMessageCount, ==, 1);
+    loggerUnsubscribeAll();
+    assert_false(loggerIsLevelEnabled(LOG_LEVEL_FATAL));
+
+    return MUNIT_OK;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#define CONCURRENT_THREAD_COUNT 4
+#define CONCURRENT_MESSAGE_COUNT 1000
+
+static uint32_t concurrentMessageCount = 0;
+
+static void concurrentCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    assert_true(checkFileEntry(message, " | INFO | THREAD - concurrent message: ["));
+    assert_true(length == strlen(message));
+    concurrentMessageCount++;   // callbacks are serialized by logger
+}
+
+static void *concurrentLoggerThread(void *argument) {
+    for (uint32_t i = 0; i < CONCURRENT_MESSAGE_COUNT; i++) {
+        LOG_INFO("THREAD", "concurrent message: [%u:%u]", *(uint32_t *) argument, i);
+    }
+    return NULL;
+}
+
+static MunitResult testConcurrentLogger(const MunitParameter params[], void *testString) {
+    concurrentMessageCount = 0;
+    assert_true(subscribeCustomLogger(LOG_LEVEL_INFO, concurrentCallbackFun)->isSubscribed);
+
+    pthread_t threads[CONCURRENT_THREAD_COUNT];
+    uint32_t threadIds[CONCURRENT_THREAD_COUNT];
+    for (uint32_t i = 0; i < CONCURRENT_THREAD_COUNT; i++) {
+        threadIds[i] = i;
+        assert_int(pthread_create(&threads[i], NULL, concurrentLoggerThread, &threadIds[i]), ==, 0);
+    }
+
+    for (uint32_t i = 0; i < CONCURRENT_THREAD_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert_uint32(concurrentMessageCount, ==, CONCURRENT_THREAD_COUNT * CONCURRENT_MESSAGE_COUNT);
+    loggerUnsubscribeAll();
+
+    return MUNIT_OK;
+}
+
+static uint32_t snapshotMessageCount = 0;
+
+static void snapshotCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    snapshotMessageCount++;     // callbacks of single subscriber are serialized
+}
+
+static void emptyCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+}
+
+static MunitResult testSubscriberSnapshot(const MunitParameter params[], void *testString) {
+    LoggerEvent *first = subscribeCustomLogger(LOG_LEVEL_INFO, emptyCallbackFun);
+    LoggerEvent *second = subscribeCustomLogger(LOG_LEVEL_WARN, emptyCallbackFun);
+    LoggerEvent *third = subscribeCustomLogger(LOG_LEVEL_ERROR, emptyCallbackFun);
+    loggerUnsubscribe(second);     // other subscribers are not moved
+    assert_true(first->isSubscribed && first->level == LOG_LEVEL_INFO);
+    assert_true(third->isSubscribed && third->level == LOG_LEVEL_ERROR);
+    loggerUnsubscribeAll();
+
+    snapshotMessageCount = 0;
+    assert_true(subscribeCustomLogger(LOG_LEVEL_INFO, snapshotCallbackFun)->isSubscribed);
+    pthread_t threads[CONCURRENT_THREAD_COUNT];
+    uint32_t threadIds[CONCURRENT_THREAD_COUNT];
+    for (uint32_t i = 0; i < CONCURRENT_THREAD_COUNT; i++) {
+        threadIds[i] = i;
+        assert_int(pthread_create(&threads[i], NULL, concurrentLoggerThread, &threadIds[i]), ==, 0);
+    }
+
+    for (uint32_t i = 0; i < 100; i++) {   // subscribers change while threads are logging
+        LoggerEvent *event = subscribeCustomLogger(LOG_LEVEL_INFO, emptyCallbackFun);
+        assert_true(event->isSubscribed);
+        loggerUnsubscribe(event);
+    }
+
+    for (uint32_t i = 0; i < CONCURRENT_THREAD_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert_uint32(snapshotMessageCount, ==, CONCURRENT_THREAD_COUNT * CONCURRENT_MESSAGE_COUNT);
+    loggerUnsubscribeAll();
+
+    return MUNIT_OK;
+}
+#endif
+
+static uint32_t asyncMessageCount = 0;
+
+static void asyncLoggerCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    char expected[64] = {0};
+    sprintf(expected, " | INFO | ASYNC - async message: [%u]\n", asyncMessageCount);
+    assert_true(checkFileEntry(message, expected));     // messages are dispatched in order
+    asyncMessageCount++;
+}
+
+static MunitResult testAsyncLogger(const MunitParameter params[], void *testString) {
+    asyncMessageCount = 0;
+    assert_true(loggerStartAsync(4096));
+    LoggerEvent *event = subscribeCustomLogger(LOG_LEVEL_INFO, asyncLoggerCallbackFun);
+    assert_true(event->isSubscribed);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        LOG_DEBUG("ASYNC", "filtered message: [%u]", i);
+        LOG_INFO("ASYNC", "async message: [%u]", i);
+    }
+    loggerFlush();
+    assert_uint32(asyncMessageCount, ==, 1000);
+
+    LOG_INFO("ASYNC", "async message: [%u]", 1000);
+    loggerStopAsync();  // drains the queue before stop
+    assert_uint32(asyncMessageCount, ==, 1001);
+
+    LOG_INFO("ASYNC", "async message: [%u]", 1001);   // synchronous after stop
+    assert_uint32(asyncMessageCount, ==, 1002);
+    loggerUnsubscribeAll();
+
+    return MUNIT_OK;
+}
+
+static char deferredMessages[8][LOGGER_BUFFER_SIZE];
+static uint32_t deferredMessageCount = 0;
+
+static void deferredLoggerCallbackFun(LogLevel severity, const char *message, uint32_t length) {
+    strcpy(deferredMessages[deferredMessageCount++], message);
+}
+
+static MunitResult testDeferredFormatting(const MunitParameter params[], void *testString) {
+    deferredMessageCount = 0;
+    assert_true(loggerStartAsync(64));
+    loggerSetDeferredFormatting(true);
+    subscribeCustomLogger(LOG_LEVEL_INFO, deferredLoggerCallbackFun);
+
+    char expected[8][LOGGER_BUFFER_SIZE] = {0};
+    char text[16] = "temporary";
+    LOG_INFO("DEFER", "int: [%d], unsigned: [%05u], hex: [%#x], char: [%c]", -42, 42U, 255, 'Z');
+    sprintf(expected[0], " | INFO | DEFER - int: [%d], unsigned: [%05u], hex: [%#x], char: [%c]\n", -42, 42U, 255, 'Z');
+    LOG_INFO("DEFER", "long: [%ld], long long: [%lld], size: [%zu], 100%%", -1L, 1LL << 40, (size_t) 7);
+    sprintf(expected[1], " | INFO | DEFER - long: [%ld], long long: [%lld], size: [%zu], 100%%\n", -1L, 1LL << 40, (size_t) 7);
+    LOG_INFO("DEFER", "double: [%.3f], exp: [%e], star: [%*.*f]", 3.14159, 1e10, 10, 2, 2.5);
+    sprintf(expected[2], " | INFO | DEFER - double: [%.3f], exp: [%e], star: [%*.*f]\n", 3.14159, 1e10, 10, 2, 2.5);
+    LOG_INFO("DEFER", "string: [%s], padded: [%-12s], precision: [%.4s], star: [%.*s]", text, text, text, 2, text);
+    sprintf(expected[3], " | INFO | DEFER - string: [%s], padded: [%-12s], precision: [%.4s], star: [%.*s]\n", text, text, text, 2, text);
+    strcpy(text, "overwritten");    // captured string should not be affected
+    LOG_INFO("DEFER", "null: [%s]", (char *) NULL);
+    strcpy(expected[4], " | INFO | DEFER - null: [(null)]\n");
+    const char *format = "not literal: [%d]";
+    LOG_INFO("DEFER", format, 1);
+    strcpy(expected[5], " | INFO | DEFER - not literal: [1]\n");
+
+    loggerFlush();
+    assert_uint32(deferredMessageCount, ==, 6);
+    for (uint32_t i = 0; i < deferredMessageCount; i++) {
+        assert_true(checkFileEntry(deferredMessages[i], expected[i]));
+    }
+
+    loggerStopAsync();
+    loggerSetDeferredFormatting(false);
+    loggerUnsubscribeAll();
+    return MUNIT_OK;
+}
+
 static MunitTest loggerTests[] = {
         {.name =  "Test console logger - should correctly log messages to console", .test = testConsoleLogger},
         {.name =  "Test file logger - should correctly log messages to file and rotate them", .test = testFileLogger},
+        {.name =  "Test background rotation - should move rotated files to backups on rotation thread", .test = testBackgroundRotation},
+        {.name =  "Test standby file - should switch to pre-opened standby file on rotation", .test = testStandbyFile},
+        {.name =  "Test time rotation - should rotate file when rotation period ended", .test = testTimeRotation},
+        {.name =  "Test existing backup files - should load backups from directory and remove extra ones", .test = testExistingBackupFiles},
+        {.name =  "Test backup retention - should remove oldest backups over total size and age", .test = testBackupRetention},
         {.name =  "Test file logger - should correctly log messages when no space left", .test = testLogToFileOverflow},
+        {.name =  "Test file sync policy - should sync file according to policy", .test = testFileSyncPolicy},
+        {.name =  "Test file write buffer - should combine messages in write buffer", .test = testFileWriteBuffer},
+        {.name =  "Test binary file logger - should decode binary file to the same text", .test = testBinaryFileLogger},
         {.name =  "Test custom logger - should correctly format messages for custom logger", .test = testLogCustomCallback},
         {.name =  "Test logLevelToString() - should correctly convert level to string", .test = testLogLevelToString},
         {.name =  "Test stringToLogLevel() - should correctly convert string to level", .test = testStringToLogLevel},
         {.name =  "Test overflow - should correctly work with string overflow", .test = testOverflowLogger},
+        {.name =  "Test multiple subscribers - should receive the same rendered message", .test = testMultipleSubscribers},
+        {.name =  "Test timestamp precision - should append fraction of a second to timestamp", .test = testTimestampPrecision},
+        {.name =  "Test compile level - should strip messages below compile level", .test = testCompileLevel},
+        {.name =  "Test threshold level - should track the lowest subscriber level", .test = testThresholdLevel},
+        {.name =  "Test tag level - should filter messages by runtime level of tag", .test = testTagLevel},
+        {.name =  "Test tag hierarchy - should apply the most specific dotted tag rule", .test = testTagHierarchy},
+        {.name =  "Test tag filter - should deliver messages only to subscribers accepting the tag", .test = testTagFilter},
+        {.name =  "Test rate limited logging - should log only messages passing rate of call site", .test = testRateLimitedLogging},
+        {.name =  "Test deduplication - should summarize consecutive repeated messages", .test = testDeduplication},
+        {.name =  "Test subscriber registry - should grow and keep subscriber handles stable", .test = testSubscriberRegistry},
+#if !defined(_WIN32) && !defined(_WIN64)
+        {.name =  "Test concurrent logger - should log messages from multiple threads", .test = testConcurrentLogger},
+        {.name =  "Test subscriber snapshot - should dispatch without lock while subscribers change", .test = testSubscriberSnapshot},
+#endif
+        {.name =  "Test async logger - should dispatch queued messages in order from backend thread", .test = testAsyncLogger},
+        {.name =  "Test deferred formatting - should format captured arguments on backend thread", .test = testDeferredFormatting},
         END_OF_TESTS
 };
 
@@ -0,0 +1,30 @@
+#include "Logger.h"
+
+// Converts binary log file written by subscribeBinaryFileLogger() back to text log format
+// Usage: logger-decode <binary.log> [output.log], output is written to stdout if not specified
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <binary.log> [output.log]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *input = fopen(argv[1], "rb");
+    if (input == NULL) {
+        fprintf(stderr, "ERROR: Failed to open binary log file: [%s]\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *output = (argc == 3) ? fopen(argv[2], "w") : stdout;
+    if (output == NULL) {
+        fprintf(stderr, "ERROR: Failed to open/create file: [%s]\n", argv[2]);
+        fclose(input);
+        return EXIT_FAILURE;
+    }
+
+    bool isDecoded = loggerDecodeBinaryFile(input, output);
+    fclose(input);
+    if (output != stdout) {
+        fclose(output);
+    }
+    return isDecoded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -4,6 +4,7 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -17,7 +18,7 @@
     #include <unistd.h>
 #endif
 
-// define the maximum number of concurrent subscribers
+// initial capacity of subscriber registry, it's doubled when more subscribers are added
 #ifndef LOGGER_MAX_SUBSCRIBERS
 #define LOGGER_MAX_SUBSCRIBERS 8
 #endif
@@ -35,6 +36,41 @@
 #define LOGGER_FILE_NAME_MAX_SIZE 256  // with null character
 #endif
 
+// minimal level of messages compiled into the program, for example: -DLOGGER_COMPILE_LEVEL=LOG_LEVEL_INFO
+#ifndef LOGGER_COMPILE_LEVEL
+#define LOGGER_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
+
+// maximum number of format conversions for deferred formatting, messages with more are formatted immediately
+#ifndef LOGGER_MAX_DEFERRED_ARGUMENTS
+#define LOGGER_MAX_DEFERRED_ARGUMENTS 16
+#endif
+
+// distinct tags remembered by binary file logger, other tags are written along with each message
+#ifndef LOGGER_BINARY_MAX_TAGS
+#define LOGGER_BINARY_MAX_TAGS 256
+#endif
+
+// maximum number of distinct tags with runtime level, messages with other tags use default tag level
+#ifndef LOGGER_MAX_TAGS
+#define LOGGER_MAX_TAGS 256
+#endif
+
+// default fraction of a second in message timestamp, see LogTimestampPrecision
+#ifndef LOGGER_TIMESTAMP_PRECISION
+#define LOGGER_TIMESTAMP_PRECISION LOG_TIMESTAMP_SECONDS
+#endif
+
+// default number of messages in asynchronous queue, rounded up to power of two
+#ifndef LOGGER_ASYNC_QUEUE_SIZE
+#define LOGGER_ASYNC_QUEUE_SIZE 1024
+#endif
+
+// backend thread sleep time when asynchronous queue is empty
+#ifndef LOGGER_ASYNC_IDLE_SLEEP_US
+#define LOGGER_ASYNC_IDLE_SLEEP_US 1000
+#endif
+
 typedef enum LogLevel {
     LOG_LEVEL_UNKNOWN,
     LOG_LEVEL_TRACE,
@@ -45,48 +81,256 @@ typedef enum LogLevel {
     LOG_LEVEL_FATAL,
 } LogLevel;
 
+typedef enum LogTimestampPrecision {
+    LOG_TIMESTAMP_SECONDS,
+    LOG_TIMESTAMP_MILLISECONDS,
+    LOG_TIMESTAMP_MICROSECONDS,
+    LOG_TIMESTAMP_NANOSECONDS,
+} LogTimestampPrecision;
+
+typedef enum LogFileSyncMode {
+    LOG_FILE_SYNC_ALWAYS,   // flush and sync every message to disk
+    LOG_FILE_SYNC_FLUSH,    // flush every message to OS without sync
+    LOG_FILE_SYNC_PERIODIC, // flush and sync after number of bytes written or time elapsed
+    LOG_FILE_SYNC_NONE,     // leave flushing to file buffer and OS
+} LogFileSyncMode;
+
+typedef enum LogRotationPeriod {
+    LOG_ROTATION_NONE,      // rotate only by file size
+    LOG_ROTATION_HOURLY,    // at the start of each hour of local time
+    LOG_ROTATION_DAILY,     // at local midnight
+    LOG_ROTATION_INTERVAL,  // when rotationIntervalMs elapsed since file was started
+} LogRotationPeriod;
+
+typedef struct LogFileSyncPolicy {
+    LogFileSyncMode mode;
+    uint32_t bytes;         // periodic mode: sync when this amount of bytes written since last sync, 0 to disable
+    uint32_t intervalMs;    // periodic mode: sync when this time elapsed since last sync, 0 to disable
+    LogLevel level;         // messages with this or higher level are synced immediately in any mode, LOG_LEVEL_UNKNOWN to disable
+    bool isDataOnly;        // use fdatasync() where available, file metadata is not synced
+} LogFileSyncPolicy;
+
+typedef struct LogFileConfig {
+    const char *fileName;
+    uint32_t maxFileSize;
+    uint8_t maxBackupFiles;
+    LogFileSyncPolicy sync;  // zero initialized policy syncs every message
+    uint32_t bufferSize;     // size of write buffer for combining messages into single write, 0 for default stdio buffer
+                             // default LOG_FILE_SYNC_ALWAYS and LOG_FILE_SYNC_FLUSH write out every message, so buffer needs other sync mode
+    uint32_t flushIntervalMs;   // write out buffered messages when this time elapsed since last write out, 0 to disable
+    bool isBackgroundRotation;  // log call only switches to new file, old file is closed and moved to backups by rotation thread
+    bool isStandbyFile;         // keep the next active file created and opened, so rotation only renames it, implies isBackgroundRotation, not supported on Windows
+    bool isStandbyPreallocated; // reserve maxFileSize of disk space for standby file, where fallocate() is available
+    LogRotationPeriod rotationPeriod;   // time based rotation in addition to maxFileSize
+    uint32_t rotationIntervalMs;        // period of LOG_ROTATION_INTERVAL
+    uint64_t maxTotalSize;      // limit of active and backup files together, oldest backups are removed first, 0 for no limit
+    uint32_t maxBackupAgeSec;   // backups closed earlier than this are removed on rotation, 0 to keep them
+} LogFileConfig;
+
 typedef struct LoggerEvent LoggerEvent;
-typedef void (*LoggerFunction)(LoggerEvent *event, LogLevel severity);
+typedef struct LogRecord LogRecord;
+typedef struct LogFormat LogFormat;
+typedef struct LogBinaryDictionary LogBinaryDictionary;
+typedef struct LogTagFilter LogTagFilter;
+typedef struct LogDeduplicator LogDeduplicator;
+typedef void (*LoggerFunction)(LoggerEvent *event, LogRecord *record);
 typedef void (*LoggerCallback)(LogLevel severity, const char *message, uint32_t length);
 
+#if defined(_WIN32) || defined(_WIN64)
+typedef CRITICAL_SECTION LoggerMutex;
+#else
+typedef pthread_mutex_t LoggerMutex;
+#endif
+
 typedef struct LogFile {
     uint8_t id;
     char *name;
     FILE *out;
-    uint32_t size;
+    uint64_t size;
     uint32_t maxSize;
+    time_t closeTime;   // when backup file was written last time
 } LogFile;
 
 struct LoggerEvent {
     LogFile *file;
     LogFile *backupFiles;
     uint8_t maxBackupFiles;
+    LogFileSyncPolicy syncPolicy;
+    uint32_t unsyncedBytes;
+    uint64_t lastSyncTime;
+    char *writeBuffer;
+    uint32_t writeBufferSize;
+    uint32_t bufferedBytes;
+    uint32_t flushIntervalMs;
+    uint64_t lastFlushTime;
+    LogBinaryDictionary *dictionary;   // format strings and tags already written to binary log file
+    bool isBackgroundRotation;
+    uint32_t rotationCount;         // unique id of rotated file waiting for rotation thread
+    char *spareWriteBuffer;         // write buffer returned by rotation thread after closing rotated file
+    bool isStandbyFile;
+    bool isStandbyPreallocated;
+    char *standbyName;              // "name.log.standby"
+    FILE *standbyOut;               // NULL until standby is created after previous rotation
+    LogRotationPeriod rotationPeriod;
+    uint32_t rotationIntervalMs;
+    uint64_t rotationDeadline;      // monotonic time of the next time based rotation, 0 if disabled
+    time_t fileStartTime;           // backup name timestamp of time based rotation
+    uint64_t maxTotalSize;
+    uint32_t maxBackupAgeSec;
+    uint64_t backupSize;            // sum of backup file sizes, tracked by rotation without checking files
 
     LogLevel level;
     LoggerFunction function;
     LoggerCallback callback;
-    const char *format;
-    const char *tag;
     bool isSubscribed;
     char *buffer;
-    va_list list;
+    LoggerMutex mutex;  // serializes writes of single subscriber, subscribers are dispatched independently
+    uint32_t registryIndex;
+    LoggerEvent *nextRetired;   // unsubscribed records are kept, so stale handle is never dangling
+    _Atomic(LogTagFilter *) allowedTags;    // only messages with these tags are delivered, NULL to accept any tag
+    _Atomic(LogTagFilter *) deniedTags;     // messages with these tags are never delivered
+    LogDeduplicator *deduplicator;  // collapses consecutive identical messages, NULL when disabled
 };
 
-#define LOG_TRACE(TAG, ...) logMessage(TAG, LOG_LEVEL_TRACE, __VA_ARGS__)
-#define LOG_DEBUG(TAG, ...) logMessage(TAG, LOG_LEVEL_DEBUG, __VA_ARGS__)
-#define LOG_INFO(TAG, ...) logMessage(TAG, LOG_LEVEL_INFO, __VA_ARGS__)
-#define LOG_WARN(TAG, ...) logMessage(TAG, LOG_LEVEL_WARN, __VA_ARGS__)
-#define LOG_ERROR(TAG, ...) logMessage(TAG, LOG_LEVEL_ERROR, __VA_ARGS__)
-#define LOG_FATAL(TAG, ...) logMessage(TAG, LOG_LEVEL_FATAL, __VA_ARGS__)
+typedef struct LogTagEntry {    // interned tag with runtime level, entries are never removed
+    _Atomic(const char *) name;
+    uint32_t hash;
+    atomic_schar level;         // effective level resolved from tag rules, checked by logging macros
+} LogTagEntry;
+
+typedef struct LoggerSite {    // static state of single logging macro call
+    _Atomic(LogFormat *) format;    // parsed format string, created by logger on first use
+    _Atomic(const char *) tag;      // tag pointer of cached entry, set once
+    _Atomic(LogTagEntry *) tagEntry;
+} LoggerSite;
+
+// messages below compile level are removed by compiler as dead code, so their arguments are never evaluated
+// runtime levels are checked inline against the lowest subscriber threshold, so filtered messages never enter the library
+// tag level is checked by cached tag entry of call site, so after the first call it's a pointer compare and a byte load
+// cache is keyed by tag pointer, so tag must be a string literal or other string which is never changed
+// rate condition is evaluated only for enabled messages, so disabled messages don't consume the rate of call site
+#define LOG_MESSAGE_IF(TAG, LEVEL, CONDITION, ...) do {                     \
+    static LoggerSite loggerSite;                                           \
+    if ((LEVEL) >= LOGGER_COMPILE_LEVEL && loggerIsLevelEnabled(LEVEL)) {   \
+        const char *loggerTag = (TAG);                                      \
+        if (loggerIsSiteTagEnabled(&loggerSite, loggerTag, LEVEL) && (CONDITION)) { \
+            logSiteMessage(&loggerSite, loggerTag, LEVEL, __VA_ARGS__);     \
+        }                                                                   \
+    }                                                                       \
+} while (0)
+
+#define LOG_MESSAGE(TAG, LEVEL, ...) LOG_MESSAGE_IF(TAG, LEVEL, true, __VA_ARGS__)
+
+// logs every N-th message of call site, starting with the first one
+#define LOG_EVERY_N(TAG, LEVEL, N, ...) do {                                \
+    static atomic_uint loggerSiteCount;                                     \
+    LOG_MESSAGE_IF(TAG, LEVEL, loggerIsEveryN(&loggerSiteCount, N), __VA_ARGS__); \
+} while (0)
+
+// logs only first N messages of call site
+#define LOG_FIRST_N(TAG, LEVEL, N, ...) do {                                \
+    static atomic_uint loggerSiteCount;                                     \
+    LOG_MESSAGE_IF(TAG, LEVEL, loggerIsFirstN(&loggerSiteCount, N), __VA_ARGS__); \
+} while (0)
+
+// logs at most one message of call site per interval
+#define LOG_EVERY_MS(TAG, LEVEL, INTERVAL_MS, ...) do {                     \
+    static atomic_uint_least64_t loggerSiteTime;                            \
+    LOG_MESSAGE_IF(TAG, LEVEL, loggerIsIntervalElapsed(&loggerSiteTime, INTERVAL_MS), __VA_ARGS__); \
+} while (0)
+
+// logs message with probability in range [0, 1]
+#define LOG_SAMPLED(TAG, LEVEL, PROBABILITY, ...) LOG_MESSAGE_IF(TAG, LEVEL, loggerIsSampled(PROBABILITY), __VA_ARGS__)
+
+#define LOG_TRACE(TAG, ...) LOG_MESSAGE(TAG, LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(TAG, ...) LOG_MESSAGE(TAG, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(TAG, ...) LOG_MESSAGE(TAG, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(TAG, ...) LOG_MESSAGE(TAG, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(TAG, ...) LOG_MESSAGE(TAG, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_FATAL(TAG, ...) LOG_MESSAGE(TAG, LOG_LEVEL_FATAL, __VA_ARGS__)
+
+#define LOG_TRACE_EVERY_N(TAG, N, ...) LOG_EVERY_N(TAG, LOG_LEVEL_TRACE, N, __VA_ARGS__)
+#define LOG_DEBUG_EVERY_N(TAG, N, ...) LOG_EVERY_N(TAG, LOG_LEVEL_DEBUG, N, __VA_ARGS__)
+#define LOG_INFO_EVERY_N(TAG, N, ...) LOG_EVERY_N(TAG, LOG_LEVEL_INFO, N, __VA_ARGS__)
+#define LOG_WARN_EVERY_N(TAG, N, ...) LOG_EVERY_N(TAG, LOG_LEVEL_WARN, N, __VA_ARGS__)
+#define LOG_ERROR_EVERY_N(TAG, N, ...) LOG_EVERY_N(TAG, LOG_LEVEL_ERROR, N, __VA_ARGS__)
+#define LOG_FATAL_EVERY_N(TAG, N, ...) LOG_EVERY_N(TAG, LOG_LEVEL_FATAL, N, __VA_ARGS__)
+
+#define LOG_TRACE_FIRST_N(TAG, N, ...) LOG_FIRST_N(TAG, LOG_LEVEL_TRACE, N, __VA_ARGS__)
+#define LOG_DEBUG_FIRST_N(TAG, N, ...) LOG_FIRST_N(TAG, LOG_LEVEL_DEBUG, N, __VA_ARGS__)
+#define LOG_INFO_FIRST_N(TAG, N, ...) LOG_FIRST_N(TAG, LOG_LEVEL_INFO, N, __VA_ARGS__)
+#define LOG_WARN_FIRST_N(TAG, N, ...) LOG_FIRST_N(TAG, LOG_LEVEL_WARN, N, __VA_ARGS__)
+#define LOG_ERROR_FIRST_N(TAG, N, ...) LOG_FIRST_N(TAG, LOG_LEVEL_ERROR, N, __VA_ARGS__)
+#define LOG_FATAL_FIRST_N(TAG, N, ...) LOG_FIRST_N(TAG, LOG_LEVEL_FATAL, N, __VA_ARGS__)
+
+#define LOG_TRACE_EVERY_MS(TAG, INTERVAL_MS, ...) LOG_EVERY_MS(TAG, LOG_LEVEL_TRACE, INTERVAL_MS, __VA_ARGS__)
+#define LOG_DEBUG_EVERY_MS(TAG, INTERVAL_MS, ...) LOG_EVERY_MS(TAG, LOG_LEVEL_DEBUG, INTERVAL_MS, __VA_ARGS__)
+#define LOG_INFO_EVERY_MS(TAG, INTERVAL_MS, ...) LOG_EVERY_MS(TAG, LOG_LEVEL_INFO, INTERVAL_MS, __VA_ARGS__)
+#define LOG_WARN_EVERY_MS(TAG, INTERVAL_MS, ...) LOG_EVERY_MS(TAG, LOG_LEVEL_WARN, INTERVAL_MS, __VA_ARGS__)
+#define LOG_ERROR_EVERY_MS(TAG, INTERVAL_MS, ...) LOG_EVERY_MS(TAG, LOG_LEVEL_ERROR, INTERVAL_MS, __VA_ARGS__)
+#define LOG_FATAL_EVERY_MS(TAG, INTERVAL_MS, ...) LOG_EVERY_MS(TAG, LOG_LEVEL_FATAL, INTERVAL_MS, __VA_ARGS__)
+
+#define LOG_TRACE_SAMPLED(TAG, PROBABILITY, ...) LOG_SAMPLED(TAG, LOG_LEVEL_TRACE, PROBABILITY, __VA_ARGS__)
+#define LOG_DEBUG_SAMPLED(TAG, PROBABILITY, ...) LOG_SAMPLED(TAG, LOG_LEVEL_DEBUG, PROBABILITY, __VA_ARGS__)
+#define LOG_INFO_SAMPLED(TAG, PROBABILITY, ...) LOG_SAMPLED(TAG, LOG_LEVEL_INFO, PROBABILITY, __VA_ARGS__)
+#define LOG_WARN_SAMPLED(TAG, PROBABILITY, ...) LOG_SAMPLED(TAG, LOG_LEVEL_WARN, PROBABILITY, __VA_ARGS__)
+#define LOG_ERROR_SAMPLED(TAG, PROBABILITY, ...) LOG_SAMPLED(TAG, LOG_LEVEL_ERROR, PROBABILITY, __VA_ARGS__)
+#define LOG_FATAL_SAMPLED(TAG, PROBABILITY, ...) LOG_SAMPLED(TAG, LOG_LEVEL_FATAL, PROBABILITY, __VA_ARGS__)
+
+extern atomic_int loggerThresholdLevel;   // lowest level accepted by any subscriber
+
+static inline bool loggerIsLevelEnabled(LogLevel level) {
+    return (int) level >= atomic_load_explicit(&loggerThresholdLevel, memory_order_relaxed);
+}
+
+bool loggerIsTagEnabled(LoggerSite *site, const char *tag, LogLevel level);
+
+static inline bool loggerIsSiteTagEnabled(LoggerSite *site, const char *tag, LogLevel level) {
+    if (tag != NULL && atomic_load_explicit(&site->tag, memory_order_acquire) == tag) {
+        LogTagEntry *entry = atomic_load_explicit(&site->tagEntry, memory_order_relaxed);
+        return (int) level >= atomic_load_explicit(&entry->level, memory_order_relaxed);
+    }
+    return loggerIsTagEnabled(site, tag, level);  // first call or tag is not a constant
+}
+
+static inline bool loggerIsEveryN(atomic_uint *count, uint32_t n) {
+    return n <= 1 || atomic_fetch_add_explicit(count, 1, memory_order_relaxed) % n == 0;
+}
+
+static inline bool loggerIsFirstN(atomic_uint *count, uint32_t n) {    // count stops at n, so it never wraps around
+    return atomic_load_explicit(count, memory_order_relaxed) < n && atomic_fetch_add_explicit(count, 1, memory_order_relaxed) < n;
+}
+
+bool loggerIsIntervalElapsed(atomic_uint_least64_t *lastTimeMs, uint32_t intervalMs);
+bool loggerIsSampled(double probability);
 
 LoggerEvent *subscribeFileLogger(LogLevel threshold, const char *fileName, uint32_t maxFileSize, uint8_t maxBackupFiles);
+LoggerEvent *subscribeFileLoggerWithConfig(LogLevel threshold, const LogFileConfig *config);
+LoggerEvent *subscribeBinaryFileLogger(LogLevel threshold, const LogFileConfig *config);
 LoggerEvent *subscribeConsoleLogger(LogLevel threshold);
 LoggerEvent *subscribeCustomLogger(LogLevel threshold, LoggerCallback callback);
 
 void loggerUnsubscribe(LoggerEvent *subscriber);
 void loggerUnsubscribeAll();
+void loggerSetLevel(LoggerEvent *subscriber, LogLevel threshold);
+void loggerSetTagLevel(const char *tag, LogLevel threshold);
+void loggerClearTagLevel(const char *tag);
+void loggerSetDefaultTagLevel(LogLevel threshold);
+void loggerAllowTags(LoggerEvent *subscriber, const char *const tags[], uint32_t count);
+void loggerDenyTags(LoggerEvent *subscriber, const char *const tags[], uint32_t count);
+// in synchronous mode summary of repeats is written only by the next message or loggerFlush(), not when window elapses
+void loggerEnableDeduplication(LoggerEvent *subscriber, uint32_t windowMs);
+
+bool loggerStartAsync(uint32_t queueSize);
+void loggerStopAsync();
+void loggerSetDeferredFormatting(bool isEnabled);
+void loggerFlush();
 
 const char *logLevelToString(LogLevel severity);
 LogLevel stringToLogLevel(const char *severity);
 
+void loggerSetTimestampPrecision(LogTimestampPrecision precision);
+bool loggerDecodeBinaryFile(FILE *input, FILE *output);
+
 void logMessage(const char *tag, LogLevel severity, const char *format, ...);
+void logSiteMessage(LoggerSite *site, const char *tag, LogLevel severity, const char *format, ...);